@@ -13,34 +13,71 @@
 
 	.align 4
 
+/*
+ * Both loops stream through a FIFO managed by the host with
+ * target_run_flash_async_algorithm() / target_run_read_async_algorithm():
+ * the FIFO starts with the write pointer and the read pointer, followed
+ * by the data.  A pointer cleared by the host aborts the loop.
+ */
+
 /* Inputs:
- *  r0	buffer address
- *  r1	NAND data address (byte wide)
- *  r2	buffer length
+ *  r0	NAND data address (byte wide)
+ *  r1	byte count
+ *  r2	FIFO start
+ *  r3	FIFO end
  */
 read:
-	ldrb	r3, [r1]
-	strb	r3, [r0], #1
-	subs	r2, r2, #1
+	ldr		r4, [r2, #4]	/* rp */
+	cmp		r4, #0
+	beq		done_read
+	ldr		r5, [r2, #0]	/* wp */
+	adds	r6, r5, #1
+	cmp		r6, r3
+	bcc		read_no_wrap
+	mov		r6, r2
+	adds	r6, #8
+read_no_wrap:
+	cmp		r6, r4			/* FIFO full? */
+	beq		read
+	ldrb	r7, [r0]
+	strb	r7, [r5]
+	str		r6, [r2, #0]
+	subs	r1, #1
 	bne		read
 
 done_read:
 	bkpt #0
+	nop
 
 	.align 4
 
 /* Inputs:
  *  r0	NAND data address (byte wide)
- *  r1	buffer address
- *  r2	buffer length
+ *  r1	byte count
+ *  r2	FIFO start
+ *  r3	FIFO end
  */
 write:
-	ldrb	r3, [r1], #1
-	strb	r3, [r0]
-	subs	r2, r2, #1
+	ldr		r4, [r2, #0]	/* wp */
+	cmp		r4, #0
+	beq		done_write
+	ldr		r5, [r2, #4]	/* rp */
+	cmp		r4, r5			/* FIFO empty? */
+	beq		write
+	ldrb	r6, [r5]
+	adds	r5, #1
+	strb	r6, [r0]
+	cmp		r5, r3
+	bcc		write_no_wrap
+	mov		r5, r2
+	adds	r5, #8
+write_no_wrap:
+	str		r5, [r2, #4]
+	subs	r1, #1
 	bne		write
 
 done_write:
 	bkpt #0
+	nop
 
 	.end
@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+"""
+Drive several debug adapters from one control script.
+
+OpenOCD serves one adapter per process. This script starts one OpenOCD
+instance per adapter serial number, each with its own Tcl RPC port and with
+the GDB and telnet servers disabled, and runs the same commands on all of
+them in parallel. The instances run on separate host cores, and the script
+is the shared control plane: it reports the result of every board and exits
+with an error if any of them failed.
+
+Example, programming four boards at once:
+
+./ocd_multi.py -f interface/cmsis-dap.cfg -f target/stm32f4x.cfg \\
+    -s 0001 -s 0002 -s 0003 -s 0004 \\
+    "program firmware.elf verify reset"
+"""
+
+import argparse
+import socket
+import subprocess
+import sys
+import threading
+import time
+
+
+class OpenOcdInstance:
+    COMMAND_TOKEN = b'\x1a'
+
+    def __init__(self, openocd, configs, serial, port):
+        self.serial = serial
+        self.port = port
+        args = [openocd]
+        for cfg in configs:
+            args += ["-f", cfg]
+        args += ["-c", "adapter serial %s" % serial,
+                 "-c", "tcl port %d" % port,
+                 "-c", "gdb port disabled",
+                 "-c", "telnet port disabled",
+                 "-c", "init"]
+        self.log = open("openocd-%s.log" % serial, "w")
+        self.process = subprocess.Popen(args, stdout=self.log,
+                                        stderr=subprocess.STDOUT)
+        self.sock = None
+
+    def connect(self, timeout):
+        deadline = time.monotonic() + timeout
+        while True:
+            if self.process.poll() is not None:
+                raise RuntimeError("OpenOCD exited, see openocd-%s.log" %
+                                   self.serial)
+            try:
+                self.sock = socket.create_connection(("127.0.0.1", self.port))
+                return
+            except OSError:
+                if time.monotonic() > deadline:
+                    raise
+                time.sleep(0.1)
+
+    def send(self, cmd):
+        self.sock.sendall(cmd.encode("utf-8") + self.COMMAND_TOKEN)
+        data = bytes()
+        while not data.endswith(self.COMMAND_TOKEN):
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                raise RuntimeError("connection closed")
+            data += chunk
+        return data[:-1].decode("utf-8")
+
+    def run(self, cmd):
+        """Run a Tcl command, return (ok, result) without raising on Tcl errors."""
+        reply = self.send("set _rc [catch {%s} _msg]; format \"%%d %%s\" $_rc $_msg"
+                          % cmd)
+        rc, _, msg = reply.partition(" ")
+        return rc == "0", msg.strip()
+
+    def close(self):
+        try:
+            if self.sock:
+                self.send("shutdown")
+                self.sock.close()
+        except (OSError, RuntimeError):
+            pass
+        try:
+            self.process.wait(timeout=10)
+        except subprocess.TimeoutExpired:
+            self.process.kill()
+        self.log.close()
+
+
+def run_board(instance, commands, timeout, results):
+    try:
+        instance.connect(timeout)
+        for cmd in commands:
+            ok, msg = instance.run(cmd)
+            results[instance.serial].append((cmd, ok, msg))
+            if not ok:
+                break
+    except (OSError, RuntimeError) as e:
+        results[instance.serial].append(("connect", False, str(e)))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="run OpenOCD commands on several adapters in parallel")
+    parser.add_argument("-f", "--file", action="append", required=True,
+                        help="configuration file, as for openocd -f")
+    parser.add_argument("-s", "--serial", action="append", required=True,
+                        help="adapter serial number, one per board")
+    parser.add_argument("-p", "--base-port", type=int, default=6700,
+                        help="Tcl RPC port of the first instance")
+    parser.add_argument("--openocd", default="openocd",
+                        help="OpenOCD executable")
+    parser.add_argument("--timeout", type=float, default=10,
+                        help="seconds to wait for each instance to start")
+    parser.add_argument("commands", nargs="+",
+                        help="Tcl commands run in order on every board")
+    args = parser.parse_args()
+
+    instances = [OpenOcdInstance(args.openocd, args.file, serial,
+                                 args.base_port + i)
+                 for i, serial in enumerate(args.serial)]
+    results = {serial: [] for serial in args.serial}
+
+    threads = [threading.Thread(target=run_board,
+                                args=(i, args.commands, args.timeout, results))
+               for i in instances]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    for i in instances:
+        i.close()
+
+    failed = 0
+    for serial in args.serial:
+        ok = all(r[1] for r in results[serial]) and \
+            len(results[serial]) == len(args.commands)
+        failed += not ok
+        print("%s: %s" % (serial, "ok" if ok else "FAILED"))
+        for cmd, cmd_ok, msg in results[serial]:
+            if msg or not cmd_ok:
+                print("    %s: %s" % (cmd, msg))
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
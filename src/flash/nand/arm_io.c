@@ -62,10 +62,67 @@ static int arm_code_to_working_area(struct target *target,
 	return retval;
 }
 
+/**
+ * Streams @a size bytes between the host and the NAND data register through
+ * a FIFO in the copy area, using the asynchronous algorithm support of the
+ * target.  The FIFO (read/write pointers plus data) directly follows the
+ * loop code and spans the chunk size, so pages larger than the working
+ * area can be transferred in one algorithm run while the host keeps the
+ * FIFO filled (or drained).
+ *
+ * @param nand Pointer to the arm_nand_data struct that defines the I/O
+ * @param code_size Size of the loop code at the start of the copy area
+ * @param data Host buffer to transfer from or to
+ * @param size Number of bytes to transfer
+ * @param arm_algo Architecture specific algorithm information
+ * @return Success or failure of the operation
+ */
+static int arm_nand_stream(struct arm_nand_data *nand, unsigned int code_size,
+	uint8_t *data, uint32_t size, void *arm_algo)
+{
+	struct target *target = nand->target;
+	struct reg_param reg_params[4];
+	uint32_t fifo_start = nand->copy_area->address + code_size;
+	uint32_t fifo_size = ARM_NAND_FIFO_HDR_SIZE + nand->chunk_size;
+	int retval;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, nand->data);
+	buf_set_u32(reg_params[1].value, 0, 32, size);
+	buf_set_u32(reg_params[2].value, 0, 32, fifo_start);
+	buf_set_u32(reg_params[3].value, 0, 32, fifo_start + fifo_size);
+
+	if (nand->op == ARM_NAND_WRITE)
+		retval = target_run_flash_async_algorithm(target, data, size, 1,
+				0, NULL, ARRAY_SIZE(reg_params), reg_params,
+				fifo_start, fifo_size,
+				nand->copy_area->address, 0, arm_algo);
+	else
+		retval = target_run_read_async_algorithm(target, data, size, 1,
+				0, NULL, ARRAY_SIZE(reg_params), reg_params,
+				fifo_start, fifo_size,
+				nand->copy_area->address, 0, arm_algo);
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+	destroy_reg_param(&reg_params[2]);
+	destroy_reg_param(&reg_params[3]);
+
+	return retval;
+}
+
 /**
  * ARM-specific bulk write from buffer to address of 8-bit wide NAND.
  * For now this supports ARMv4,ARMv5 and ARMv7-M cores.
  *
+ * ARMv7-M cores stream the data through a FIFO in the working area.  The
+ * other cores get one algorithm run per chunk, since they cannot run an
+ * algorithm asynchronously.
+ *
  * Enhancements to target_run_algorithm() could enable:
  *   - ARMv6 and ARMv7 cores in ARM mode
  *
@@ -87,6 +144,8 @@ int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
 	struct reg_param reg_params[3];
 	uint32_t target_buf;
 	uint32_t exit_var = 0;
+	unsigned int additional = nand->chunk_size;
+	bool stream = false;
 	int retval;
 
 	/* Inputs:
@@ -106,21 +165,30 @@ int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
 
 	/* Inputs:
 	 *  r0	NAND data address (byte wide)
-	 *  r1	buffer address
-	 *  r2	buffer length
+	 *  r1	byte count
+	 *  r2	FIFO start (write pointer, read pointer, data)
+	 *  r3	FIFO end
 	 *
 	 * see contrib/loaders/flash/armv7m_io.s for src
 	 */
 	static const uint32_t code_armv7m[] = {
-		0x3b01f811,
-		0x3a017003,
-		0xaffaf47f,
+		0x2c006814,
+		0x6855d00c,
+		0xd0f942ac,
+		0x3501782e,
+		0x429d7006,
+		0x4615d301,
+		0x60553508,
+		0xd1ef3901,
 		0xbf00be00,
 	};
 
 	int target_code_size = 0;
 	const uint32_t *target_code_src = NULL;
 
+	if (size <= 0)
+		return ERROR_OK;
+
 	/* set up algorithm */
 	if (is_armv7m(target_to_armv7m(target))) {  /* armv7m target */
 		armv7m_algo.common_magic = ARMV7M_COMMON_MAGIC;
@@ -128,6 +196,8 @@ int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
 		arm_algo = &armv7m_algo;
 		target_code_size = sizeof(code_armv7m);
 		target_code_src = code_armv7m;
+		additional += ARM_NAND_FIFO_HDR_SIZE;
+		stream = true;
 	} else {
 		armv4_5_algo.common_magic = ARM_COMMON_MAGIC;
 		armv4_5_algo.core_mode = ARM_MODE_SVC;
@@ -139,37 +209,55 @@ int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
 
 	if (nand->op != ARM_NAND_WRITE || !nand->copy_area) {
 		retval = arm_code_to_working_area(target, target_code_src, target_code_size,
-				nand->chunk_size, &nand->copy_area);
+				additional, &nand->copy_area);
 		if (retval != ERROR_OK)
 			return retval;
 	}
 
 	nand->op = ARM_NAND_WRITE;
 
-	/* copy data to work area */
-	target_buf = nand->copy_area->address + target_code_size;
-	retval = target_write_buffer(target, target_buf, size, data);
-	if (retval != ERROR_OK)
+	if (stream) {
+		retval = arm_nand_stream(nand, target_code_size, data, size, arm_algo);
+		if (retval != ERROR_OK)
+			LOG_ERROR("error executing hosted NAND write");
 		return retval;
+	}
+
+	target_buf = nand->copy_area->address + target_code_size;
+
+	/* armv4 must exit using a hardware breakpoint */
+	if (arm->arch == ARM_ARCH_V4)
+		exit_var = nand->copy_area->address + target_code_size - 4;
 
 	/* set up parameters */
 	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN);
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_IN);
 	init_reg_param(&reg_params[2], "r2", 32, PARAM_IN);
 
-	buf_set_u32(reg_params[0].value, 0, 32, nand->data);
-	buf_set_u32(reg_params[1].value, 0, 32, target_buf);
-	buf_set_u32(reg_params[2].value, 0, 32, size);
+	/* one run per chunk, the copy area only has room for that much */
+	while (size > 0) {
+		uint32_t thisrun_size = MIN((unsigned int)size, nand->chunk_size);
 
-	/* armv4 must exit using a hardware breakpoint */
-	if (arm->arch == ARM_ARCH_V4)
-		exit_var = nand->copy_area->address + target_code_size - 4;
+		/* copy data to work area */
+		retval = target_write_buffer(target, target_buf, thisrun_size, data);
+		if (retval != ERROR_OK)
+			break;
+
+		buf_set_u32(reg_params[0].value, 0, 32, nand->data);
+		buf_set_u32(reg_params[1].value, 0, 32, target_buf);
+		buf_set_u32(reg_params[2].value, 0, 32, thisrun_size);
 
-	/* use alg to write data from work area to NAND chip */
-	retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
-			nand->copy_area->address, exit_var, 1000, arm_algo);
-	if (retval != ERROR_OK)
-		LOG_ERROR("error executing hosted NAND write");
+		/* use alg to write data from work area to NAND chip */
+		retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
+				nand->copy_area->address, exit_var, 1000, arm_algo);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("error executing hosted NAND write");
+			break;
+		}
+
+		data += thisrun_size;
+		size -= thisrun_size;
+	}
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
@@ -180,7 +268,8 @@ int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
 
 /**
  * Uses an on-chip algorithm for an ARM device to read from a NAND device and
- * store the data into the host machine's memory.
+ * store the data into the host machine's memory.  Like arm_nandwrite(), this
+ * streams through a FIFO on ARMv7-M and runs once per chunk elsewhere.
  *
  * @param nand Pointer to the arm_nand_data struct that defines the I/O
  * @param data Pointer to the data buffer to store the read data
@@ -197,6 +286,8 @@ int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size)
 	struct reg_param reg_params[3];
 	uint32_t target_buf;
 	uint32_t exit_var = 0;
+	unsigned int additional = nand->chunk_size;
+	bool stream = false;
 	int retval;
 
 	/* Inputs:
@@ -215,22 +306,31 @@ int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size)
 	};
 
 	/* Inputs:
-	 *  r0	buffer address
-	 *  r1	NAND data address (byte wide)
-	 *  r2	buffer length
+	 *  r0	NAND data address (byte wide)
+	 *  r1	byte count
+	 *  r2	FIFO start (write pointer, read pointer, data)
+	 *  r3	FIFO end
 	 *
 	 * see contrib/loaders/flash/armv7m_io.s for src
 	 */
 	static const uint32_t code_armv7m[] = {
-		0xf800780b,
-		0x3a013b01,
-		0xaffaf47f,
+		0x2c006854,
+		0x6815d00c,
+		0x429e1c6e,
+		0x4616d301,
+		0x42a63608,
+		0x7807d0f4,
+		0x6016702f,
+		0xd1ef3901,
 		0xbf00be00,
 	};
 
 	int target_code_size = 0;
 	const uint32_t *target_code_src = NULL;
 
+	if (!size)
+		return ERROR_OK;
+
 	/* set up algorithm */
 	if (is_armv7m(target_to_armv7m(target))) {  /* armv7m target */
 		armv7m_algo.common_magic = ARMV7M_COMMON_MAGIC;
@@ -238,6 +338,8 @@ int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size)
 		arm_algo = &armv7m_algo;
 		target_code_size = sizeof(code_armv7m);
 		target_code_src = code_armv7m;
+		additional += ARM_NAND_FIFO_HDR_SIZE;
+		stream = true;
 	} else {
 		armv4_5_algo.common_magic = ARM_COMMON_MAGIC;
 		armv4_5_algo.core_mode = ARM_MODE_SVC;
@@ -250,39 +352,59 @@ int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size)
 	/* create the copy area if not yet available */
 	if (nand->op != ARM_NAND_READ || !nand->copy_area) {
 		retval = arm_code_to_working_area(target, target_code_src, target_code_size,
-				nand->chunk_size, &nand->copy_area);
+				additional, &nand->copy_area);
 		if (retval != ERROR_OK)
 			return retval;
 	}
 
 	nand->op = ARM_NAND_READ;
+
+	if (stream) {
+		retval = arm_nand_stream(nand, target_code_size, data, size, arm_algo);
+		if (retval != ERROR_OK)
+			LOG_ERROR("error executing hosted NAND read");
+		return retval;
+	}
+
 	target_buf = nand->copy_area->address + target_code_size;
 
+	/* armv4 must exit using a hardware breakpoint */
+	if (arm->arch == ARM_ARCH_V4)
+		exit_var = nand->copy_area->address + target_code_size - 4;
+
 	/* set up parameters */
 	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN);
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_IN);
 	init_reg_param(&reg_params[2], "r2", 32, PARAM_IN);
 
-	buf_set_u32(reg_params[0].value, 0, 32, target_buf);
-	buf_set_u32(reg_params[1].value, 0, 32, nand->data);
-	buf_set_u32(reg_params[2].value, 0, 32, size);
+	/* one run per chunk, the copy area only has room for that much */
+	while (size > 0) {
+		uint32_t thisrun_size = MIN(size, nand->chunk_size);
 
-	/* armv4 must exit using a hardware breakpoint */
-	if (arm->arch == ARM_ARCH_V4)
-		exit_var = nand->copy_area->address + target_code_size - 4;
+		buf_set_u32(reg_params[0].value, 0, 32, target_buf);
+		buf_set_u32(reg_params[1].value, 0, 32, nand->data);
+		buf_set_u32(reg_params[2].value, 0, 32, thisrun_size);
+
+		/* use alg to write data from NAND chip to work area */
+		retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
+				nand->copy_area->address, exit_var, 1000, arm_algo);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("error executing hosted NAND read");
+			break;
+		}
 
-	/* use alg to write data from NAND chip to work area */
-	retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
-			nand->copy_area->address, exit_var, 1000, arm_algo);
-	if (retval != ERROR_OK)
-		LOG_ERROR("error executing hosted NAND read");
+		/* read from work area to the host's memory */
+		retval = target_read_buffer(target, target_buf, thisrun_size, data);
+		if (retval != ERROR_OK)
+			break;
+
+		data += thisrun_size;
+		size -= thisrun_size;
+	}
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
 	destroy_reg_param(&reg_params[2]);
 
-	/* read from work area to the host's memory */
-	retval = target_read_buffer(target, target_buf, size, data);
-
 	return retval;
 }
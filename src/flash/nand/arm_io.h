@@ -6,6 +6,12 @@
 #ifndef OPENOCD_FLASH_NAND_ARM_IO_H
 #define OPENOCD_FLASH_NAND_ARM_IO_H
 
+/**
+ * Size of the read and write pointers heading the FIFO that is used to
+ * stream data on cores supporting asynchronous algorithms.
+ */
+#define ARM_NAND_FIFO_HDR_SIZE 8
+
 /**
  * Available operational states the arm_nand_data struct can be in.
  */
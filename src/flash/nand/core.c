@@ -690,6 +690,73 @@ int nand_read_page(struct nand_device *nand, uint32_t page,
 		return nand->controller->read_page(nand, page, data, data_size, oob, oob_size);
 }
 
+/**
+ * Write @a count consecutive pages, starting at @a first_page.  The data
+ * and OOB buffers hold the pages back to back, @a data_size and
+ * @a oob_size bytes per page; either may be NULL as for nand_write_page().
+ * Callers are expected to prepare the whole batch (including any software
+ * ECC) beforehand, so the pages go out to the device back to back.
+ * On return, @a done holds the number of pages written successfully.
+ */
+int nand_write_pages(struct nand_device *nand, uint32_t first_page, uint32_t count,
+	uint8_t *data, uint32_t data_size,
+	uint8_t *oob, uint32_t oob_size, uint32_t *done)
+{
+	*done = 0;
+	if (!nand->device)
+		return ERROR_NAND_DEVICE_NOT_PROBED;
+
+	for (uint32_t i = 0; i < count; i++, (*done)++) {
+		int retval = nand_write_page(nand, first_page + i,
+				data ? data + i * data_size : NULL, data_size,
+				oob ? oob + i * oob_size : NULL, oob_size);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("writing NAND page %" PRIu32 " failed", first_page + i);
+			return retval;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+/**
+ * Read @a count consecutive pages, starting at @a first_page, into
+ * back to back buffers; the counterpart of nand_write_pages().
+ */
+int nand_read_pages(struct nand_device *nand, uint32_t first_page, uint32_t count,
+	uint8_t *data, uint32_t data_size,
+	uint8_t *oob, uint32_t oob_size, uint32_t *done)
+{
+	*done = 0;
+	if (!nand->device)
+		return ERROR_NAND_DEVICE_NOT_PROBED;
+
+	for (uint32_t i = 0; i < count; i++, (*done)++) {
+		int retval = nand_read_page(nand, first_page + i,
+				data ? data + i * data_size : NULL, data_size,
+				oob ? oob + i * oob_size : NULL, oob_size);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("reading NAND page %" PRIu32 " failed", first_page + i);
+			return retval;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+/**
+ * Number of pages that nand_read_pages()/nand_write_pages() callers should
+ * batch: one erase block, which bounds the buffer size while keeping the
+ * per-batch overhead negligible.
+ */
+uint32_t nand_pages_per_batch(struct nand_device *nand)
+{
+	if (!nand->device || !nand->page_size || nand->erase_size < nand->page_size)
+		return 1;
+
+	return nand->erase_size / nand->page_size;
+}
+
 int nand_page_command(struct nand_device *nand, uint32_t page,
 	uint8_t cmd, bool oob_only)
 {
@@ -5,8 +5,9 @@
  * and correction of 1-bit errors in a 256 byte block of data.
  *
  * [ Extracted from the initial code found in some early Linux versions.
- *   The current Linux code is bigger while being faster, but this is of
- *   no real benefit when the bottleneck largely remains the JTAG link.  ]
+ *   The parity accumulation has since been reworked to process the data
+ *   one 32-bit word at a time, like the current Linux code does, so that
+ *   software ECC does not dominate large "nand write" operations.  ]
  *
  * Copyright (C) 2000-2004 Steven J. Hill (sjhill at realitydiluted.com)
  *                         Toshiba America Electronics Components, Inc.
@@ -42,29 +43,51 @@ static const uint8_t nand_ecc_precalc_table[] = {
 	0x00, 0x55, 0x56, 0x03, 0x59, 0x0c, 0x0f, 0x5a, 0x5a, 0x0f, 0x0c, 0x59, 0x03, 0x56, 0x55, 0x00
 };
 
+static inline uint8_t nand_ecc_parity32(uint32_t x)
+{
+	x ^= x >> 16;
+	x ^= x >> 8;
+	return (nand_ecc_precalc_table[x & 0xff] >> 6) & 0x01;
+}
+
 /*
  * nand_calculate_ecc - Calculate 3-byte ECC for 256-byte block
+ *
+ * Column parity and line parity are both linear in the data, so instead
+ * of looking up every byte the block is folded 32 bits at a time and only
+ * the few resulting words are reduced to parity bits at the end.
  */
 int nand_calculate_ecc(struct nand_device *nand, const uint8_t *dat, uint8_t *ecc_code)
 {
-	uint8_t idx, reg1, reg2, reg3, tmp1, tmp2;
-	int i;
-
-	/* Initialize variables */
-	reg1 = reg2 = reg3 = 0;
-
-	/* Build up column parity */
-	for (i = 0; i < 256; i++) {
-		/* Get CP0 - CP5 from table */
-		idx = nand_ecc_precalc_table[*dat++];
-		reg1 ^= (idx & 0x3f);
-
-		/* All bit XOR = 1 ? */
-		if (idx & 0x40) {
-			reg3 ^= (uint8_t) i;
-			reg2 ^= ~((uint8_t) i);
+	uint8_t reg1, reg2, reg3, tmp1, tmp2;
+	uint32_t word[64], par, rp[6] = { 0 };
+	unsigned int i, n, bit;
+
+	for (i = 0; i < 64; i++)
+		word[i] = le_to_h_u32(dat + 4 * i);
+
+	/* Fold the words pairwise; the odd half of each level feeds one line parity bit */
+	for (bit = 0, n = 32; bit < 6; bit++, n /= 2) {
+		for (i = 0; i < n; i++) {
+			rp[bit] ^= word[2 * i + 1];
+			word[i] = word[2 * i] ^ word[2 * i + 1];
 		}
 	}
+	par = word[0];
+
+	/* Line parity: bit n set if the bytes at offsets with bit n set have odd parity */
+	reg3 = nand_ecc_parity32(par & 0xff00ff00) << 0;
+	reg3 |= nand_ecc_parity32(par & 0xffff0000) << 1;
+	for (bit = 0; bit < 6; bit++)
+		reg3 |= nand_ecc_parity32(rp[bit]) << (bit + 2);
+
+	/* The complementary line parity differs only if the whole block has odd parity */
+	reg2 = nand_ecc_parity32(par) ? ~reg3 : reg3;
+
+	/* Column parity of the block equals column parity of all bytes XORed together */
+	par ^= par >> 16;
+	par ^= par >> 8;
+	reg1 = nand_ecc_precalc_table[par & 0xff] & 0x3f;
 
 	/* Create non-inverted ECC code from line parity */
 	tmp1  = (reg3 & 0x80) >> 0; /* B7 -> B7 */
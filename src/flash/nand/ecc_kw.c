@@ -36,6 +36,19 @@ static uint16_t gf_exp[1023 + 1023];
  */
 static uint16_t gf_log[1024];
 
+/*
+ * Discrete logs of the generator polynomial coefficients, highest order
+ * first, followed by the per-coefficient product tables derived from them:
+ * gf_mul_gen[k][b] = b * x ^ gen_log[k], with gf_mul_gen[k][0] = 0.  This
+ * turns each reduction step into one lookup per coefficient, without the
+ * zero test and the log/exp double lookup.
+ */
+static const uint16_t gen_log[8] = {
+	0x21c, 0x181, 0x18e, 0x25f, 0x197, 0x193, 0x237, 0x024,
+};
+
+static uint16_t gf_mul_gen[8][1024];
+
 static void gf_build_log_exp_table(void)
 {
 	int i;
@@ -60,6 +73,12 @@ static void gf_build_log_exp_table(void)
 		if (p_i & (1 << 10))
 			p_i ^= MODPOLY;
 	}
+
+	for (i = 0; i < 8; i++) {
+		gf_mul_gen[i][0] = 0;
+		for (p_i = 1; p_i < 1024; p_i++)
+			gf_mul_gen[i][p_i] = gf_exp[gf_log[p_i] + gen_log[i]];
+	}
 }
 
 
@@ -119,33 +138,21 @@ int nand_calculate_ecc_kw(struct nand_device *nand, const uint8_t *data, uint8_t
 	 * generator polynomial in every step.
 	 */
 	for (i = 503; i >= -8; i--) {
-		unsigned int d;
+		unsigned int d, t;
 
 		d = 0;
 		if (i >= 0)
 			d = data[i];
 
-		if (r7) {
-			uint16_t *t = gf_exp + gf_log[r7];
-
-			r7 = r6 ^ t[0x21c];
-			r6 = r5 ^ t[0x181];
-			r5 = r4 ^ t[0x18e];
-			r4 = r3 ^ t[0x25f];
-			r3 = r2 ^ t[0x197];
-			r2 = r1 ^ t[0x193];
-			r1 = r0 ^ t[0x237];
-			r0 = d  ^ t[0x024];
-		} else {
-			r7 = r6;
-			r6 = r5;
-			r5 = r4;
-			r4 = r3;
-			r3 = r2;
-			r2 = r1;
-			r1 = r0;
-			r0 = d;
-		}
+		t = r7;
+		r7 = r6 ^ gf_mul_gen[0][t];
+		r6 = r5 ^ gf_mul_gen[1][t];
+		r5 = r4 ^ gf_mul_gen[2][t];
+		r4 = r3 ^ gf_mul_gen[3][t];
+		r3 = r2 ^ gf_mul_gen[4][t];
+		r2 = r1 ^ gf_mul_gen[5][t];
+		r1 = r0 ^ gf_mul_gen[6][t];
+		r0 = d  ^ gf_mul_gen[7][t];
 	}
 
 	ecc[0] = r0;
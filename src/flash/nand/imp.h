@@ -20,6 +20,16 @@ int nand_read_page(struct nand_device *nand, uint32_t page,
 		uint8_t *data, uint32_t data_size,
 		uint8_t *oob, uint32_t oob_size);
 
+int nand_write_pages(struct nand_device *nand, uint32_t first_page,
+		uint32_t count, uint8_t *data, uint32_t data_size,
+		uint8_t *oob, uint32_t oob_size, uint32_t *done);
+
+int nand_read_pages(struct nand_device *nand, uint32_t first_page,
+		uint32_t count, uint8_t *data, uint32_t data_size,
+		uint8_t *oob, uint32_t oob_size, uint32_t *done);
+
+uint32_t nand_pages_per_batch(struct nand_device *nand);
+
 int nand_probe(struct nand_device *nand);
 int nand_erase(struct nand_device *nand, int first_block, int last_block);
 int nand_build_bbt(struct nand_device *nand, int first, int last);
@@ -78,14 +78,24 @@ int s3c2440_read_block_data(struct nand_device *nand, uint8_t *data, int data_si
 	struct target *target = nand->target;
 	uint32_t nfdata = s3c24xx_info->data;
 	uint32_t tmp;
+	int status;
 
-	LOG_INFO("%s: reading data: %p, %p, %d", __func__, nand, data, data_size);
+	LOG_DEBUG("%s: reading data: %p, %p, %d", __func__, nand, data, data_size);
 
 	if (target->state != TARGET_HALTED) {
 		LOG_ERROR("target must be halted to use S3C24XX NAND flash controller");
 		return ERROR_NAND_OPERATION_FAILED;
 	}
 
+	/* try the fast way first */
+	s3c24xx_info->io.data = nfdata;
+	s3c24xx_info->io.chunk_size = nand->page_size;
+	status = arm_nandread(&s3c24xx_info->io, data, data_size);
+	if (status != ERROR_NAND_NO_BUFFER)
+		return status;
+
+	/* else do it slowly */
+
 	while (data_size >= 4) {
 		target_read_u32(target, nfdata, &tmp);
 
@@ -114,12 +124,22 @@ int s3c2440_write_block_data(struct nand_device *nand, uint8_t *data, int data_s
 	struct target *target = nand->target;
 	uint32_t nfdata = s3c24xx_info->data;
 	uint32_t tmp;
+	int status;
 
 	if (target->state != TARGET_HALTED) {
 		LOG_ERROR("target must be halted to use S3C24XX NAND flash controller");
 		return ERROR_NAND_OPERATION_FAILED;
 	}
 
+	/* try the fast way first */
+	s3c24xx_info->io.data = nfdata;
+	s3c24xx_info->io.chunk_size = nand->page_size;
+	status = arm_nandwrite(&s3c24xx_info->io, data, data_size);
+	if (status != ERROR_NAND_NO_BUFFER)
+		return status;
+
+	/* else do it slowly */
+
 	while (data_size >= 4) {
 		tmp = le_to_h_u32(data);
 		target_write_u32(target, nfdata, tmp);
@@ -22,12 +22,15 @@ S3C24XX_DEVICE_COMMAND()
 	*info = NULL;
 
 	struct s3c24xx_nand_controller *s3c24xx_info;
-	s3c24xx_info = malloc(sizeof(struct s3c24xx_nand_controller));
+	s3c24xx_info = calloc(1, sizeof(struct s3c24xx_nand_controller));
 	if (!s3c24xx_info) {
 		LOG_ERROR("no memory for nand controller");
 		return -ENOMEM;
 	}
 
+	s3c24xx_info->io.target = nand->target;
+	s3c24xx_info->io.op = ARM_NAND_NONE;
+
 	nand->controller_priv = s3c24xx_info;
 	*info = s3c24xx_info;
 
@@ -15,6 +15,7 @@
  */
 
 #include "imp.h"
+#include "arm_io.h"
 #include "s3c24xx_regs.h"
 #include <target/target.h>
 
@@ -24,6 +25,9 @@ struct s3c24xx_nand_controller {
 	uint32_t		 addr;
 	uint32_t		 data;
 	uint32_t		 nfstat;
+
+	/* on-target copy loop for block data transfers */
+	struct arm_nand_data	 io;
 };
 
 /* Default to using the un-translated NAND register based address */
@@ -235,28 +235,58 @@ COMMAND_HANDLER(handle_nand_write_command)
 	if (retval != ERROR_OK)
 		return retval;
 
+	/* Prepare a whole batch of pages (including software ECC) before
+	 * handing it to the device, so the transfers go out back to back */
+	uint32_t batch = nand_pages_per_batch(nand);
+	uint8_t *data = s.page ? malloc(batch * s.page_size) : NULL;
+	uint8_t *oob = s.oob ? malloc(batch * s.oob_size) : NULL;
+	if ((s.page && !data) || (s.oob && !oob)) {
+		LOG_ERROR("Out of memory");
+		free(data);
+		free(oob);
+		nand_fileio_cleanup(&s);
+		return ERROR_FAIL;
+	}
+
 	uint32_t total_bytes = s.size;
 	while (s.size > 0) {
-		int bytes_read = nand_fileio_read(nand, &s);
-		if (bytes_read <= 0) {
-			command_print(CMD, "error while reading file");
-			nand_fileio_cleanup(&s);
-			return ERROR_FAIL;
+		uint32_t count = 0;
+		while (s.size > 0 && count < batch) {
+			int bytes_read = nand_fileio_read(nand, &s);
+			if (bytes_read <= 0) {
+				command_print(CMD, "error while reading file");
+				free(data);
+				free(oob);
+				nand_fileio_cleanup(&s);
+				return ERROR_FAIL;
+			}
+			s.size -= bytes_read;
+
+			if (data)
+				memcpy(data + count * s.page_size, s.page, s.page_size);
+			if (oob)
+				memcpy(oob + count * s.oob_size, s.oob, s.oob_size);
+			count++;
 		}
-		s.size -= bytes_read;
 
-		retval = nand_write_page(nand, s.address / nand->page_size,
-				s.page, s.page_size, s.oob, s.oob_size);
+		uint32_t done;
+		retval = nand_write_pages(nand, s.address / nand->page_size, count,
+				data, s.page_size, oob, s.oob_size, &done);
 		if (retval != ERROR_OK) {
 			command_print(CMD, "failed writing file %s "
 				"to NAND flash %s at offset 0x%8.8" PRIx32,
-				CMD_ARGV[1], CMD_ARGV[0], s.address);
+				CMD_ARGV[1], CMD_ARGV[0], s.address + done * nand->page_size);
+			free(data);
+			free(oob);
 			nand_fileio_cleanup(&s);
 			return retval;
 		}
-		s.address += s.page_size;
+		s.address += count * nand->page_size;
 	}
 
+	free(data);
+	free(oob);
+
 	if (nand_fileio_finish(&s) == ERROR_OK) {
 		command_print(CMD, "wrote file %s to NAND flash %s up to "
 			"offset 0x%8.8" PRIx32 " in %fs (%0.3f KiB/s)",
@@ -335,26 +365,50 @@ COMMAND_HANDLER(handle_nand_dump_command)
 	if (retval != ERROR_OK)
 		return retval;
 
+	uint32_t batch = nand_pages_per_batch(nand);
+	uint8_t *data = s.page ? malloc(batch * s.page_size) : NULL;
+	uint8_t *oob = s.oob ? malloc(batch * s.oob_size) : NULL;
+	if ((s.page && !data) || (s.oob && !oob)) {
+		LOG_ERROR("Out of memory");
+		free(data);
+		free(oob);
+		nand_fileio_cleanup(&s);
+		return ERROR_FAIL;
+	}
+
 	while (s.size > 0) {
 		size_t size_written;
-		retval = nand_read_page(nand, s.address / nand->page_size,
-				s.page, s.page_size, s.oob, s.oob_size);
+		uint32_t count = MIN(batch, s.size / nand->page_size);
+		uint32_t done;
+		retval = nand_read_pages(nand, s.address / nand->page_size, count,
+				data, s.page_size, oob, s.oob_size, &done);
 		if (retval != ERROR_OK) {
-			command_print(CMD, "reading NAND flash page failed");
+			command_print(CMD, "reading NAND flash page %" PRIu32 " at offset 0x%8.8" PRIx32 " failed",
+				s.address / nand->page_size + done, s.address + done * nand->page_size);
+			free(data);
+			free(oob);
 			nand_fileio_cleanup(&s);
 			return retval;
 		}
 
-		if (s.page)
-			fileio_write(s.fileio, s.page_size, s.page, &size_written);
-
-		if (s.oob)
-			fileio_write(s.fileio, s.oob_size, s.oob, &size_written);
+		if (data && !oob) {
+			fileio_write(s.fileio, count * s.page_size, data, &size_written);
+		} else {
+			for (uint32_t i = 0; i < count; i++) {
+				if (data)
+					fileio_write(s.fileio, s.page_size, data + i * s.page_size, &size_written);
+				if (oob)
+					fileio_write(s.fileio, s.oob_size, oob + i * s.oob_size, &size_written);
+			}
+		}
 
-		s.size -= nand->page_size;
-		s.address += nand->page_size;
+		s.size -= count * nand->page_size;
+		s.address += count * nand->page_size;
 	}
 
+	free(data);
+	free(oob);
+
 	retval = fileio_size(s.fileio, &filesize);
 	if (retval != ERROR_OK)
 		return retval;
@@ -26,14 +26,311 @@
 
 static struct flash_bank *flash_banks;
 
+/*
+ * Content cache: a copy of the flash sectors as OpenOCD last erased, wrote,
+ * read or verified them, so that verifying right after programming does not
+ * need the target. A write only updates sectors whose previous content is
+ * known, since programming can't bring bits back to their erased value. The
+ * cache is dropped whenever memory of any target may have changed by other
+ * means, see target_memory_generation().
+ */
+struct flash_cache_sector {
+	uint32_t offset;
+	uint32_t size;
+	/* NULL if the content is not known */
+	uint8_t *data;
+};
+
+struct flash_content_cache {
+	unsigned int generation;
+	unsigned int num_sectors;
+	struct flash_cache_sector *sectors;
+};
+
+static enum flash_cache_mode flash_cache_mode = FLASH_CACHE_OFF;
+
+static void flash_cache_free(struct flash_bank *bank)
+{
+	struct flash_content_cache *cache = bank->content_cache;
+
+	if (!cache)
+		return;
+
+	for (unsigned int i = 0; i < cache->num_sectors; i++)
+		free(cache->sectors[i].data);
+	free(cache->sectors);
+	free(cache);
+	bank->content_cache = NULL;
+}
+
+/* returns the cache of @a bank if it still matches the flash content */
+static struct flash_content_cache *flash_cache_valid(struct flash_bank *bank)
+{
+	struct flash_content_cache *cache = bank->content_cache;
+
+	if (!cache)
+		return NULL;
+
+	bool valid = cache->generation == target_memory_generation(NULL)
+		&& cache->num_sectors == bank->num_sectors;
+	for (unsigned int i = 0; valid && i < cache->num_sectors; i++)
+		valid = cache->sectors[i].offset == bank->sectors[i].offset
+			&& cache->sectors[i].size == bank->sectors[i].size;
+
+	if (!valid)
+		flash_cache_free(bank);
+
+	return bank->content_cache;
+}
+
+/*
+ * Returns the cache of @a bank to be updated after a flash operation,
+ * creating it if needed. The known part of the cache is kept only if it was
+ * still valid before the operation.
+ */
+static struct flash_content_cache *flash_cache_update(struct flash_bank *bank, bool keep)
+{
+	struct flash_content_cache *cache;
+
+	if (!keep)
+		flash_cache_free(bank);
+
+	cache = bank->content_cache;
+	if (cache)
+		return cache;
+
+	if (!bank->num_sectors)
+		return NULL;
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+	cache->sectors = calloc(bank->num_sectors, sizeof(*cache->sectors));
+	if (!cache->sectors) {
+		free(cache);
+		return NULL;
+	}
+	cache->num_sectors = bank->num_sectors;
+	for (unsigned int i = 0; i < cache->num_sectors; i++) {
+		cache->sectors[i].offset = bank->sectors[i].offset;
+		cache->sectors[i].size = bank->sectors[i].size;
+	}
+	bank->content_cache = cache;
+	return cache;
+}
+
+/* Record that sectors @a first to @a last of @a bank were erased */
+static void flash_cache_erase(struct flash_bank *bank, bool keep,
+		unsigned int first, unsigned int last)
+{
+	struct flash_content_cache *cache = flash_cache_update(bank, keep);
+
+	if (!cache)
+		return;
+
+	for (unsigned int i = first; i <= last && i < cache->num_sectors; i++) {
+		struct flash_cache_sector *sector = &cache->sectors[i];
+
+		if (!sector->data)
+			sector->data = malloc(sector->size);
+		if (sector->data)
+			memset(sector->data, bank->erased_value, sector->size);
+	}
+
+	cache->generation = target_memory_generation(NULL);
+}
+
+/*
+ * Record that @a buffer was programmed at @a offset. Programming only moves
+ * bits away from their erased value, so flash which was not erased ends up
+ * with a mix of old and new data: only sectors with a known content are
+ * updated, the others stay unknown.
+ */
+static void flash_cache_program(struct flash_bank *bank, bool keep,
+		const uint8_t *buffer, uint32_t offset, uint32_t count)
+{
+	struct flash_content_cache *cache = flash_cache_update(bank, keep);
+	uint8_t erased = bank->erased_value;
+
+	if (!cache)
+		return;
+
+	for (unsigned int i = 0; i < cache->num_sectors; i++) {
+		struct flash_cache_sector *sector = &cache->sectors[i];
+		uint32_t start = MAX(offset, sector->offset);
+		uint32_t end = MIN(offset + count, sector->offset + sector->size);
+
+		if (start >= end || !sector->data)
+			continue;
+
+		uint8_t *data = sector->data + (start - sector->offset);
+		const uint8_t *src = buffer + (start - offset);
+		for (uint32_t j = 0; j < end - start; j++)
+			data[j] = erased ^ ((data[j] ^ erased) | (src[j] ^ erased));
+	}
+
+	cache->generation = target_memory_generation(NULL);
+}
+
+/*
+ * Record that the flash at @a offset was found to hold @a buffer, by reading
+ * or verifying it.
+ */
+static void flash_cache_store(struct flash_bank *bank, bool keep,
+		const uint8_t *buffer, uint32_t offset, uint32_t count)
+{
+	struct flash_content_cache *cache = flash_cache_update(bank, keep);
+
+	if (!cache)
+		return;
+
+	for (unsigned int i = 0; i < cache->num_sectors; i++) {
+		struct flash_cache_sector *sector = &cache->sectors[i];
+		uint32_t start = MAX(offset, sector->offset);
+		uint32_t end = MIN(offset + count, sector->offset + sector->size);
+
+		if (start >= end)
+			continue;
+
+		/* a partially read sector stays unknown */
+		if (!sector->data) {
+			if (end - start < sector->size)
+				continue;
+			sector->data = malloc(sector->size);
+			if (!sector->data)
+				continue;
+		}
+		memcpy(sector->data + (start - sector->offset), buffer + (start - offset),
+				end - start);
+	}
+
+	cache->generation = target_memory_generation(NULL);
+}
+
+/* compare one of the cached sectors with the flash */
+static int flash_cache_spot_check(struct flash_bank *bank, unsigned int index)
+{
+	struct flash_content_cache *cache = bank->content_cache;
+	struct flash_cache_sector *sector = &cache->sectors[index];
+	int retval;
+
+	retval = bank->driver->verify ?
+		bank->driver->verify(bank, sector->data, sector->offset, sector->size) :
+		default_flash_verify(bank, sector->data, sector->offset, sector->size);
+	if (retval != ERROR_OK) {
+		LOG_WARNING("flash content cache of bank %s differs from sector %u, dropped",
+				bank->name, index);
+		flash_cache_free(bank);
+		return retval;
+	}
+
+	/* verifying may run an algorithm, which does not change the flash */
+	cache->generation = target_memory_generation(NULL);
+	return ERROR_OK;
+}
+
+/*
+ * Read @a count bytes at @a offset from the content cache of @a bank.
+ * @returns ERROR_OK if all of them are known, ERROR_FAIL otherwise.
+ */
+static int flash_cache_read(struct flash_bank *bank,
+		uint8_t *buffer, uint32_t offset, uint32_t count)
+{
+	struct flash_content_cache *cache;
+	uint32_t pos = offset;
+	unsigned int first = 0, num = 0;
+
+	if (flash_cache_mode == FLASH_CACHE_OFF || !count)
+		return ERROR_FAIL;
+
+	cache = flash_cache_valid(bank);
+	if (!cache)
+		return ERROR_FAIL;
+
+	for (unsigned int i = 0; i < cache->num_sectors && pos < offset + count; i++) {
+		struct flash_cache_sector *sector = &cache->sectors[i];
+
+		if (sector->offset + sector->size <= pos)
+			continue;
+		if (sector->offset > pos || !sector->data)
+			return ERROR_FAIL;
+
+		uint32_t end = MIN(offset + count, sector->offset + sector->size);
+		memcpy(buffer + (pos - offset), sector->data + (pos - sector->offset), end - pos);
+		pos = end;
+
+		if (!num)
+			first = i;
+		num++;
+	}
+
+	if (pos < offset + count)
+		return ERROR_FAIL;
+
+	if (flash_cache_mode == FLASH_CACHE_PARANOID)
+		return flash_cache_spot_check(bank, first + rand() % num);
+
+	return ERROR_OK;
+}
+
+void flash_cache_set_mode(enum flash_cache_mode mode)
+{
+	flash_cache_mode = mode;
+
+	if (mode == FLASH_CACHE_OFF) {
+		for (struct flash_bank *bank = flash_banks; bank; bank = bank->next)
+			flash_cache_free(bank);
+	}
+}
+
+enum flash_cache_mode flash_cache_get_mode(void)
+{
+	return flash_cache_mode;
+}
+
+int flash_cache_checksum(struct target *target, target_addr_t addr,
+		uint32_t count, uint32_t *checksum)
+{
+	struct flash_bank *bank;
+	uint8_t *buffer;
+	int retval;
+
+	if (flash_cache_mode == FLASH_CACHE_OFF)
+		return ERROR_FAIL;
+
+	for (bank = flash_banks; bank; bank = bank->next) {
+		if (bank->target == target && addr >= bank->base
+				&& addr - bank->base < bank->size)
+			break;
+	}
+	if (!bank || count > bank->size - (addr - bank->base))
+		return ERROR_FAIL;
+
+	buffer = malloc(count);
+	if (!buffer)
+		return ERROR_FAIL;
+
+	retval = flash_cache_read(bank, buffer, addr - bank->base, count);
+	if (retval == ERROR_OK)
+		retval = image_calculate_checksum(buffer, count, checksum);
+	free(buffer);
+
+	return retval;
+}
+
 int flash_driver_erase(struct flash_bank *bank, unsigned int first,
 		unsigned int last)
 {
 	int retval;
+	bool keep = flash_cache_valid(bank);
 
 	retval = bank->driver->erase(bank, first, last);
-	if (retval != ERROR_OK)
+	if (retval != ERROR_OK) {
 		LOG_ERROR("failed erasing sectors %u to %u", first, last);
+		flash_cache_free(bank);
+	} else if (flash_cache_mode != FLASH_CACHE_OFF) {
+		flash_cache_erase(bank, keep, first, last);
+	}
 
 	return retval;
 }
@@ -86,6 +383,7 @@ int flash_driver_write(struct flash_bank *bank,
 	const uint8_t *buffer, uint32_t offset, uint32_t count)
 {
 	int retval;
+	bool keep = flash_cache_valid(bank);
 
 	retval = bank->driver->write(bank, buffer, offset, count);
 	if (retval != ERROR_OK) {
@@ -94,6 +392,9 @@ int flash_driver_write(struct flash_bank *bank,
 			" at offset 0x%8.8" PRIx32,
 			bank->base,
 			offset);
+		flash_cache_free(bank);
+	} else if (flash_cache_mode != FLASH_CACHE_OFF) {
+		flash_cache_program(bank, keep, buffer, offset, count);
 	}
 
 	return retval;
@@ -106,6 +407,11 @@ int flash_driver_read(struct flash_bank *bank,
 
 	LOG_DEBUG("call flash_driver_read()");
 
+	if (flash_cache_read(bank, buffer, offset, count) == ERROR_OK)
+		return ERROR_OK;
+
+	bool keep = flash_cache_valid(bank);
+
 	retval = bank->driver->read(bank, buffer, offset, count);
 	if (retval != ERROR_OK) {
 		LOG_ERROR(
@@ -113,6 +419,8 @@ int flash_driver_read(struct flash_bank *bank,
 			" at offset 0x%8.8" PRIx32,
 			bank->base,
 			offset);
+	} else if (flash_cache_mode != FLASH_CACHE_OFF) {
+		flash_cache_store(bank, keep, buffer, offset, count);
 	}
 
 	return retval;
@@ -124,21 +432,41 @@ int default_flash_read(struct flash_bank *bank,
 	return target_read_buffer(bank->target, offset + bank->base, count, buffer);
 }
 
-int flash_driver_verify(struct flash_bank *bank,
-	const uint8_t *buffer, uint32_t offset, uint32_t count)
+/* Verify the flash, from the content cache if @a use_cache allows it */
+static int flash_verify(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t offset, uint32_t count, bool use_cache)
 {
 	int retval;
 
+	if (use_cache && flash_cache_mode != FLASH_CACHE_OFF && count) {
+		uint8_t *cached = malloc(count);
+		bool same = cached && flash_cache_read(bank, cached, offset, count) == ERROR_OK
+			&& !memcmp(cached, buffer, count);
+		free(cached);
+		if (same)
+			return ERROR_OK;
+	}
+
+	bool keep = flash_cache_valid(bank);
+
 	retval = bank->driver->verify ? bank->driver->verify(bank, buffer, offset, count) :
 		default_flash_verify(bank, buffer, offset, count);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("verify failed in bank at " TARGET_ADDR_FMT " starting at 0x%8.8" PRIx32,
 			bank->base, offset);
+	} else if (flash_cache_mode != FLASH_CACHE_OFF) {
+		flash_cache_store(bank, keep, buffer, offset, count);
 	}
 
 	return retval;
 }
 
+int flash_driver_verify(struct flash_bank *bank,
+	const uint8_t *buffer, uint32_t offset, uint32_t count)
+{
+	return flash_verify(bank, buffer, offset, count, true);
+}
+
 int default_flash_verify(struct flash_bank *bank,
 	const uint8_t *buffer, uint32_t offset, uint32_t count)
 {
@@ -233,6 +561,8 @@ void flash_free_all_banks(void)
 			free(bank->prot_blocks);
 		}
 
+		flash_cache_free(bank);
+
 		free(bank->name);
 		free(bank);
 		bank = next;
@@ -970,8 +1300,8 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 
 		if (retval == ERROR_OK) {
 			if (verify) {
-				/* verify flash sectors */
-				retval = flash_driver_verify(c, buffer, run_address - c->base, run_size);
+				/* verify flash sectors, on the target if they were just written */
+				retval = flash_verify(c, buffer, run_address - c->base, run_size, !write);
 			}
 		}
 
@@ -125,6 +125,9 @@ struct flash_bank {
 	/** Array of protection blocks, allocated and initialized by the flash driver */
 	struct flash_sector *prot_blocks;
 
+	/** Content of the sectors as last programmed or read, see flash_cache_set_mode() */
+	struct flash_content_cache *content_cache;
+
 	struct flash_bank *next; /**< The next flash bank on this chip */
 };
 
@@ -173,6 +176,32 @@ target_addr_t flash_write_align_end(struct flash_bank *bank, target_addr_t addr)
 int flash_write(struct target *target,
 		struct image *image, uint32_t *written, bool erase);
 
+/** How far the content cache of the flash banks is trusted */
+enum flash_cache_mode {
+	/** always access the target */
+	FLASH_CACHE_OFF,
+	/** verify and read from the cache when its content is known */
+	FLASH_CACHE_ON,
+	/** same as on, but first compare one random sector with the flash */
+	FLASH_CACHE_PARANOID,
+};
+
+/**
+ * Sets whether reads and verifies of flash content programmed or read by
+ * OpenOCD are answered from a host copy, until the memory of a target may
+ * have changed.  Setting FLASH_CACHE_OFF drops all cached content.
+ */
+void flash_cache_set_mode(enum flash_cache_mode mode);
+enum flash_cache_mode flash_cache_get_mode(void);
+
+/**
+ * Computes the checksum of @a count bytes of flash at @a addr from the
+ * content cache, like target_checksum_memory() would on the target.
+ * @returns ERROR_OK if the whole range is cached, ERROR_FAIL otherwise.
+ */
+int flash_cache_checksum(struct target *target, target_addr_t addr,
+		uint32_t count, uint32_t *checksum);
+
 /**
  * Forces targets to re-examine their erase/protection state.
  * This routine must be called when the system may modify the status.
@@ -460,6 +460,153 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 	return retval;
 }
 
+static int flash_gang_get_bank(const char *name, struct flash_bank **bank)
+{
+	int retval = get_flash_bank_by_name(name, bank);
+	if (retval != ERROR_OK || *bank)
+		return retval;
+
+	unsigned int bank_num;
+	if (parse_uint(name, &bank_num) != ERROR_OK) {
+		LOG_ERROR("flash bank '%s' not found", name);
+		return ERROR_FAIL;
+	}
+
+	return get_flash_bank_by_num(bank_num, bank);
+}
+
+COMMAND_HANDLER(handle_flash_gang_write_image_command)
+{
+	struct image image;
+	int retval;
+	bool auto_erase = false;
+	bool auto_unlock = false;
+
+	while (CMD_ARGC) {
+		if (strcmp(CMD_ARGV[0], "erase") == 0) {
+			auto_erase = true;
+			CMD_ARGV++;
+			CMD_ARGC--;
+		} else if (strcmp(CMD_ARGV[0], "unlock") == 0) {
+			auto_unlock = true;
+			CMD_ARGV++;
+			CMD_ARGC--;
+		} else
+			break;
+	}
+
+	if (CMD_ARGC < 2 || CMD_ARGC > 4)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC >= 3) {
+		image.base_address_set = true;
+		COMMAND_PARSE_NUMBER(llong, CMD_ARGV[2], image.base_address);
+	} else {
+		image.base_address_set = false;
+		image.base_address = 0x0;
+	}
+
+	image.start_address_set = false;
+
+	Jim_Interp *interp = CMD_CTX->interp;
+	Jim_Obj *list = Jim_NewStringObj(interp, CMD_ARGV[0], -1);
+	Jim_IncrRefCount(list);
+	int num_banks = Jim_ListLength(interp, list);
+	if (num_banks < 1) {
+		Jim_DecrRefCount(interp, list);
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	struct flash_bank **banks = calloc(num_banks, sizeof(*banks));
+	if (!banks) {
+		Jim_DecrRefCount(interp, list);
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	retval = ERROR_OK;
+	for (int i = 0; i < num_banks && retval == ERROR_OK; i++) {
+		const char *name = Jim_GetString(Jim_ListGetIndex(interp, list, i), NULL);
+		retval = flash_gang_get_bank(name, &banks[i]);
+	}
+	Jim_DecrRefCount(interp, list);
+	if (retval != ERROR_OK) {
+		free(banks);
+		return retval;
+	}
+
+	/* the image is decoded once, and its sections relocated for each bank */
+	retval = image_open(&image, CMD_ARGV[1], (CMD_ARGC == 4) ? CMD_ARGV[3] : NULL);
+	if (retval != ERROR_OK) {
+		free(banks);
+		return retval;
+	}
+
+	/* the image is laid out for the first bank, it must fit in every bank */
+	struct flash_bank *first = banks[0];
+	for (unsigned int s = 0; s < image.num_sections; s++) {
+		target_addr_t start = image.sections[s].base_address;
+		target_addr_t end = start + image.sections[s].size;
+		bool fits = start >= first->base && end <= first->base + first->size;
+		for (int i = 1; fits && i < num_banks; i++)
+			fits = end - first->base <= banks[i]->size;
+		if (!fits) {
+			LOG_ERROR("image section at " TARGET_ADDR_FMT " does not fit in every bank",
+				start);
+			retval = ERROR_FAIL;
+			goto done;
+		}
+	}
+
+	unsigned int failed = 0;
+	uint32_t total = 0;
+	struct duration bench;
+	duration_start(&bench);
+
+	for (int i = 0; i < num_banks; i++) {
+		struct flash_bank *bank = banks[i];
+		target_addr_t delta = bank->base - first->base;
+		struct duration bank_bench;
+		uint32_t written;
+
+		for (unsigned int s = 0; s < image.num_sections; s++)
+			image.sections[s].base_address += delta;
+
+		duration_start(&bank_bench);
+		int bank_retval = flash_write_unlock_verify(bank->target, &image, &written,
+			auto_erase, auto_unlock, true, true);
+		duration_measure(&bank_bench);
+
+		for (unsigned int s = 0; s < image.num_sections; s++)
+			image.sections[s].base_address -= delta;
+
+		if (bank_retval != ERROR_OK) {
+			command_print(CMD, "bank %s: FAILED (%d)", bank->name, bank_retval);
+			failed++;
+			continue;
+		}
+
+		total += written;
+		command_print(CMD, "bank %s: wrote and verified %" PRIu32 " bytes "
+			"in %fs (%0.3f KiB/s)", bank->name, written,
+			duration_elapsed(&bank_bench), duration_kbps(&bank_bench, written));
+	}
+
+	if (duration_measure(&bench) == ERROR_OK)
+		command_print(CMD, "%u of %d banks programmed, %" PRIu32 " bytes from file %s "
+			"in %fs (%0.3f KiB/s)", num_banks - failed, num_banks, total,
+			CMD_ARGV[1], duration_elapsed(&bench), duration_kbps(&bench, total));
+
+	if (failed)
+		retval = ERROR_FAIL;
+
+done:
+	image_close(&image);
+	free(banks);
+
+	return retval;
+}
+
 COMMAND_HANDLER(handle_flash_verify_image_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -1073,6 +1220,31 @@ COMMAND_HANDLER(handle_flash_padded_value_command)
 	return retval;
 }
 
+COMMAND_HANDLER(handle_flash_content_cache_command)
+{
+	static const char * const modes[] = {
+		[FLASH_CACHE_OFF] = "off",
+		[FLASH_CACHE_ON] = "on",
+		[FLASH_CACHE_PARANOID] = "paranoid",
+	};
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		unsigned int mode;
+		for (mode = 0; mode < ARRAY_SIZE(modes); mode++)
+			if (!strcmp(CMD_ARGV[0], modes[mode]))
+				break;
+		if (mode == ARRAY_SIZE(modes))
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		flash_cache_set_mode(mode);
+	}
+
+	command_print(CMD, "flash content cache %s", modes[flash_cache_get_mode()]);
+	return ERROR_OK;
+}
+
 static const struct command_registration flash_exec_command_handlers[] = {
 	{
 		.name = "probe",
@@ -1187,6 +1359,15 @@ static const struct command_registration flash_exec_command_handlers[] = {
 			"and/or erase the region to be used. Allow optional "
 			"offset from beginning of bank (defaults to zero)",
 	},
+	{
+		.name = "gang_write_image",
+		.handler = handle_flash_gang_write_image_command,
+		.mode = COMMAND_EXEC,
+		.usage = "[erase] [unlock] bank_list filename [offset [file_type]]",
+		.help = "Write and verify the same image in each bank of the "
+			"list, at the same offset from the bank base as in the "
+			"first bank of the list.",
+	},
 	{
 		.name = "verify_image",
 		.handler = handle_flash_verify_image_command,
@@ -1229,6 +1410,14 @@ static const struct command_registration flash_exec_command_handlers[] = {
 		.usage = "bank_id value",
 		.help = "Set default flash padded value",
 	},
+	{
+		.name = "content_cache",
+		.handler = handle_flash_content_cache_command,
+		.mode = COMMAND_EXEC,
+		.usage = "['off'|'on'|'paranoid']",
+		.help = "Answer flash verify and read from the content "
+			"OpenOCD last programmed or read",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -13,38 +13,105 @@
 #endif
 
 #include "crc32.h"
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
-static uint32_t crc_le_step(uint32_t poly, uint32_t crc, uint32_t data_in,
-		unsigned int data_bits)
+/*
+ * Slicing-by-8: table k gives the CRC of a byte followed by k zero bytes,
+ * so that eight bytes are folded into the CRC with eight independent table
+ * lookups instead of a chain of eight.
+ */
+struct crc32_tables {
+	uint32_t poly;
+	bool reflected;
+	bool valid;
+	uint32_t table[8][256];
+};
+
+#define CRC32_TABLES	4
+
+static struct crc32_tables crc32_tables[CRC32_TABLES];
+static unsigned int crc32_tables_next;
+
+static const struct crc32_tables *crc32_get_tables(uint32_t poly, bool reflected)
 {
-	for (unsigned int i = 0; i < data_bits; i++) {
-		uint32_t d, c;
-		d = ((data_in >> i) & 0x1) ? 0xffffffff : 0;
-		c = (crc & 0x1) ? 0xffffffff : 0;
-		crc = crc >> 1;
-		crc = crc ^ ((d ^ c) & poly);
+	for (unsigned int i = 0; i < CRC32_TABLES; i++) {
+		if (crc32_tables[i].valid && crc32_tables[i].poly == poly
+				&& crc32_tables[i].reflected == reflected)
+			return &crc32_tables[i];
 	}
 
-	return crc;
+	struct crc32_tables *t = &crc32_tables[crc32_tables_next];
+	crc32_tables_next = (crc32_tables_next + 1) % CRC32_TABLES;
+
+	t->valid = false;
+	for (unsigned int i = 0; i < 256; i++) {
+		uint32_t c;
+		if (reflected) {
+			c = i;
+			for (unsigned int j = 0; j < 8; j++)
+				c = (c & 1) ? (c >> 1) ^ poly : (c >> 1);
+		} else {
+			c = i << 24;
+			for (unsigned int j = 0; j < 8; j++)
+				c = (c & 0x80000000) ? (c << 1) ^ poly : (c << 1);
+		}
+		t->table[0][i] = c;
+	}
+
+	for (unsigned int k = 1; k < 8; k++) {
+		for (unsigned int i = 0; i < 256; i++) {
+			uint32_t c = t->table[k - 1][i];
+			if (reflected)
+				t->table[k][i] = (c >> 8) ^ t->table[0][c & 0xff];
+			else
+				t->table[k][i] = (c << 8) ^ t->table[0][c >> 24];
+		}
+	}
+
+	t->poly = poly;
+	t->reflected = reflected;
+	t->valid = true;
+	return t;
 }
 
 uint32_t crc32_le(uint32_t poly, uint32_t seed, const void *_data,
 		size_t data_len)
 {
-	if (((uintptr_t)_data & 0x3) || (data_len & 0x3)) {
-		/* data is unaligned, processing data one byte at a time */
-		const uint8_t *data = _data;
-		for (size_t i = 0; i < data_len; i++)
-			seed = crc_le_step(poly, seed, data[i], 8);
-	} else {
-		/* data is aligned, processing 32 bit at a time */
-		data_len >>= 2;
-		const uint32_t *data = _data;
-		for (size_t i = 0; i < data_len; i++)
-			seed = crc_le_step(poly, seed, data[i], 32);
+	const uint32_t (*t)[256] = crc32_get_tables(poly, true)->table;
+	const uint8_t *data = _data;
+	uint32_t crc = seed;
+
+	for (; data_len >= 8; data_len -= 8, data += 8) {
+		crc ^= data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+		crc = t[7][crc & 0xff] ^ t[6][(crc >> 8) & 0xff]
+			^ t[5][(crc >> 16) & 0xff] ^ t[4][crc >> 24]
+			^ t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
 	}
 
-	return seed;
+	while (data_len--)
+		crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xff];
+
+	return crc;
+}
+
+uint32_t crc32_be(uint32_t poly, uint32_t seed, const void *_data,
+		size_t data_len)
+{
+	const uint32_t (*t)[256] = crc32_get_tables(poly, false)->table;
+	const uint8_t *data = _data;
+	uint32_t crc = seed;
+
+	for (; data_len >= 8; data_len -= 8, data += 8) {
+		crc ^= ((uint32_t)data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+		crc = t[7][crc >> 24] ^ t[6][(crc >> 16) & 0xff]
+			^ t[5][(crc >> 8) & 0xff] ^ t[4][crc & 0xff]
+			^ t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+	}
+
+	while (data_len--)
+		crc = (crc << 8) ^ t[0][(crc >> 24) ^ *data++];
+
+	return crc;
 }
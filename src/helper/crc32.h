@@ -12,7 +12,7 @@
 #include <stddef.h>
 
 /** @file
- * A generic CRC32 implementation
+ * A generic CRC32 implementation, table driven, eight bytes at a time
  */
 
 /**
@@ -20,6 +20,11 @@
  */
 #define CRC32_POLY_LE	0xedb88320
 
+/**
+ * The same polynomial, not reflected, as used by GDB for qCRC
+ */
+#define CRC32_POLY_BE	0x04c11db7
+
 /**
  * Calculate the CRC32 value of the given data
  * @param	poly		The polynomial of the CRC
@@ -34,4 +39,16 @@
 uint32_t crc32_le(uint32_t poly, uint32_t seed, const void *data,
 		size_t data_len);
 
+/**
+ * Calculate the CRC32 value of the given data, most significant bit first
+ * @param	poly		The polynomial of the CRC, not reflected
+ * @param	seed		The seed to use (mostly either `0` or `0xffffffff`)
+ * @param	data		The data to calculate the CRC32 of
+ * @param	data_len	The length of the data in @p data in bytes
+ * @return	The CRC value of the first @p data_len bytes at @p data
+ * @note	Like crc32_le(), this can be computed one chunk at a time.
+ */
+uint32_t crc32_be(uint32_t poly, uint32_t seed, const void *data,
+		size_t data_len);
+
 #endif /* OPENOCD_HELPER_CRC32_H */
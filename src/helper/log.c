@@ -65,6 +65,64 @@ static void log_forward(const char *file, unsigned int line, const char *functio
 	}
 }
 
+/* Messages are collected here and written out in batches. Debug output
+ * stays buffered until the buffer fills up, a more important message is
+ * logged or the server loop goes idle, see log_flush(). The buffer is also
+ * flushed at exit and on fatal signals. */
+#define LOG_BUFFER_SIZE 65536
+static char log_buffer[LOG_BUFFER_SIZE];
+static size_t log_buffer_len;
+
+/* Most messages are short, format them on the stack instead of the heap */
+#define LOG_LINE_SIZE 256
+
+static void log_write_buffer(void)
+{
+	if (log_buffer_len)
+		fwrite(log_buffer, 1, log_buffer_len, log_output);
+	log_buffer_len = 0;
+}
+
+void log_flush(void)
+{
+	if (!log_output)
+		return;
+
+	log_write_buffer();
+	fflush(log_output);
+}
+
+/* printf() straight into the log buffer, bypassing it if it's too small */
+static void log_append(const char *format, ...)
+	__attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 1, 2)));
+
+static void log_append(const char *format, ...)
+{
+	size_t space = LOG_BUFFER_SIZE - log_buffer_len;
+	va_list ap;
+
+	va_start(ap, format);
+	int len = vsnprintf(log_buffer + log_buffer_len, space, format, ap);
+	va_end(ap);
+
+	if (len < 0)
+		return;
+
+	if ((size_t)len < space) {
+		log_buffer_len += len;
+		return;
+	}
+
+	log_write_buffer();
+
+	va_start(ap, format);
+	if ((size_t)len < LOG_BUFFER_SIZE)
+		log_buffer_len = vsnprintf(log_buffer, LOG_BUFFER_SIZE, format, ap);
+	else
+		vfprintf(log_output, format, ap);
+	va_end(ap);
+}
+
 /* The log_puts() serves two somewhat different goals:
  *
  * - logging
@@ -92,8 +150,8 @@ static void log_puts(enum log_levels level,
 
 	if (level == LOG_LVL_OUTPUT) {
 		/* do not prepend any headers, just print out what we were given and return */
-		fputs(string, log_output);
-		fflush(log_output);
+		log_append("%s", string);
+		log_flush();
 		return;
 	}
 
@@ -108,7 +166,7 @@ static void log_puts(enum log_levels level,
 		struct mallinfo info;
 		info = mallinfo();
 #endif
-		fprintf(log_output, "%s%d %" PRId64 " %s:%d %s()"
+		log_append("%s%d %" PRId64 " %s:%d %s()"
 #ifdef _DEBUG_FREE_SPACE_
 			" %d"
 #endif
@@ -120,15 +178,35 @@ static void log_puts(enum log_levels level,
 	} else {
 		/* if we are using gdb through pipes then we do not want any output
 		 * to the pipe otherwise we get repeated strings */
-		fprintf(log_output, "%s%s",
+		log_append("%s%s",
 			(level > LOG_LVL_USER) ? log_strings[level + 1] : "", string);
 	}
 
-	fflush(log_output);
-
 	/* Never forward LOG_LVL_DEBUG, too verbose and they can be found in the log if need be */
-	if (level <= LOG_LVL_INFO)
+	if (level <= LOG_LVL_INFO) {
+		log_flush();
 		log_forward(file, line, function, string);
+	}
+}
+
+/*
+ * Format into the caller's buffer if the result fits, else into an allocated
+ * string. Like alloc_vprintf(), the result has room for one more character.
+ */
+static char *log_vformat(char *buffer, size_t size, const char *format, va_list ap)
+{
+	va_list ap_copy;
+
+	va_copy(ap_copy, ap);
+	int len = vsnprintf(buffer, size - 1, format, ap_copy);
+	va_end(ap_copy);
+
+	if (len < 0)
+		return NULL;
+	if ((size_t)len < size - 1)
+		return buffer;
+
+	return alloc_vprintf(format, ap);
 }
 
 void log_printf(enum log_levels level,
@@ -138,6 +216,7 @@ void log_printf(enum log_levels level,
 	const char *format,
 	...)
 {
+	char buffer[LOG_LINE_SIZE];
 	char *string;
 	va_list ap;
 
@@ -147,10 +226,11 @@ void log_printf(enum log_levels level,
 
 	va_start(ap, format);
 
-	string = alloc_vprintf(format, ap);
+	string = log_vformat(buffer, sizeof(buffer), format, ap);
 	if (string) {
 		log_puts(level, file, line, function, string);
-		free(string);
+		if (string != buffer)
+			free(string);
 	}
 
 	va_end(ap);
@@ -159,6 +239,7 @@ void log_printf(enum log_levels level,
 void log_vprintf_lf(enum log_levels level, const char *file, unsigned int line,
 		const char *function, const char *format, va_list args)
 {
+	char buffer[LOG_LINE_SIZE];
 	char *tmp;
 
 	count++;
@@ -166,18 +247,19 @@ void log_vprintf_lf(enum log_levels level, const char *file, unsigned int line,
 	if (level > debug_level)
 		return;
 
-	tmp = alloc_vprintf(format, args);
+	tmp = log_vformat(buffer, sizeof(buffer), format, args);
 
 	if (!tmp)
 		return;
 
 	/*
-	 * Note: alloc_vprintf() guarantees that the buffer is at least one
+	 * Note: log_vformat() guarantees that the buffer is at least one
 	 * character longer.
 	 */
 	strcat(tmp, "\n");
 	log_puts(level, file, line, function, tmp);
-	free(tmp);
+	if (tmp != buffer)
+		free(tmp);
 }
 
 void log_printf_lf(enum log_levels level,
@@ -230,6 +312,7 @@ COMMAND_HANDLER(handle_log_output_command)
 		command_print(CMD, "set log_output to default");
 	}
 
+	log_flush();
 	if (log_output != stderr && log_output) {
 		/* Close previous log file, if it was open and wasn't stderr. */
 		fclose(log_output);
@@ -281,11 +364,20 @@ void log_init(void)
 	if (!log_output)
 		log_output = stderr;
 
+	/* don't lose buffered messages on an exit() that skips log_exit() */
+	static bool flush_at_exit;
+	if (!flush_at_exit) {
+		atexit(log_flush);
+		flush_at_exit = true;
+	}
+
 	start = last_time = timeval_ms();
 }
 
 void log_exit(void)
 {
+	log_flush();
+
 	if (log_output && log_output != stderr) {
 		/* Close log file, if it was open and wasn't stderr. */
 		fclose(log_output);
@@ -429,6 +521,9 @@ void keep_alive(void)
 		/* this will keep the GDB connection alive */
 		server_keep_clients_alive();
 
+		/* long running commands should not hold back the debug log */
+		log_flush();
+
 		/* DANGER!!!! do not add code to invoke e.g. target event processing,
 		 * jim timer processing, etc. it can cause infinite recursion +
 		 * jim event callbacks need to happen at a well defined time,
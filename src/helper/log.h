@@ -63,6 +63,11 @@ __attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 5, 6)));
 void log_init(void);
 void log_exit(void);
 
+/**
+ * Write out buffered log messages.
+ */
+void log_flush(void);
+
 int log_register_commands(struct command_context *cmd_ctx);
 
 void keep_alive(void);
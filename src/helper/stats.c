@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <ctype.h>
+#include <string.h>
+
+#include "command.h"
+#include "stats.h"
+
+uint64_t stats_counters[STATS_COUNTER_COUNT];
+struct stats_histogram stats_gdb_packets[128];
+struct stats_histogram stats_timer_callbacks;
+
+static const char * const stats_counter_names[STATS_COUNTER_COUNT] = {
+	[STATS_JTAG_FLUSHES] = "jtag.flushes",
+	[STATS_JTAG_SCAN_BITS] = "jtag.scan_bits",
+	[STATS_SWD_TRANSACTIONS] = "swd.transactions",
+	[STATS_SWD_FLUSHES] = "swd.flushes",
+	[STATS_DAP_WAITS] = "dap.waits",
+	[STATS_TARGET_BYTES_READ] = "target.bytes_read",
+	[STATS_TARGET_BYTES_WRITTEN] = "target.bytes_written",
+};
+
+void stats_histogram_add(struct stats_histogram *histogram, uint64_t us)
+{
+	unsigned int bucket = 0;
+
+	while (bucket < STATS_HISTOGRAM_BUCKETS - 1 && us >= (1ULL << bucket))
+		bucket++;
+
+	histogram->count++;
+	histogram->total_us += us;
+	if (us > histogram->max_us)
+		histogram->max_us = us;
+	histogram->buckets[bucket]++;
+}
+
+static void stats_histogram_print(struct command_invocation *cmd,
+	const char *name, const struct stats_histogram *histogram)
+{
+	if (!histogram->count)
+		return;
+
+	command_print(cmd, "%s.count %" PRIu64, name, histogram->count);
+	command_print(cmd, "%s.total_us %" PRIu64, name, histogram->total_us);
+	command_print(cmd, "%s.max_us %" PRIu64, name, histogram->max_us);
+
+	for (unsigned int i = 0; i < STATS_HISTOGRAM_BUCKETS; i++) {
+		if (histogram->buckets[i])
+			command_print(cmd, "%s.lt_%" PRIu64 "us %" PRIu64, name,
+				(uint64_t)1 << i, histogram->buckets[i]);
+	}
+}
+
+/**
+ * Print all global counters and histograms, one "name value" pair per
+ * line so the output can be scraped through the Tcl server.
+ */
+void stats_print(struct command_invocation *cmd)
+{
+	for (unsigned int i = 0; i < STATS_COUNTER_COUNT; i++)
+		command_print(cmd, "%s %" PRIu64, stats_counter_names[i], stats_counters[i]);
+
+	stats_histogram_print(cmd, "timer_callbacks", &stats_timer_callbacks);
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(stats_gdb_packets); i++) {
+		char name[32];
+
+		if (isalnum(i))
+			snprintf(name, sizeof(name), "gdb.packet.%c", i);
+		else
+			snprintf(name, sizeof(name), "gdb.packet.0x%02x", i);
+		stats_histogram_print(cmd, name, &stats_gdb_packets[i]);
+	}
+}
+
+void stats_reset(void)
+{
+	memset(stats_counters, 0, sizeof(stats_counters));
+	memset(stats_gdb_packets, 0, sizeof(stats_gdb_packets));
+	memset(&stats_timer_callbacks, 0, sizeof(stats_timer_callbacks));
+}
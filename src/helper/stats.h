@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_HELPER_STATS_H
+#define OPENOCD_HELPER_STATS_H
+
+#include "types.h"
+
+struct command_invocation;
+
+/**
+ * Always-on event counters. They are plain increments on the hot paths,
+ * cheap enough to keep enabled in production, and are reported by the
+ * "stats" command.
+ */
+enum stats_counter {
+	STATS_JTAG_FLUSHES,
+	STATS_JTAG_SCAN_BITS,
+	STATS_SWD_TRANSACTIONS,
+	STATS_SWD_FLUSHES,
+	STATS_DAP_WAITS,
+	STATS_TARGET_BYTES_READ,
+	STATS_TARGET_BYTES_WRITTEN,
+	STATS_COUNTER_COUNT
+};
+
+/** Number of latency buckets, bucket n counts durations below 2^n us */
+#define STATS_HISTOGRAM_BUCKETS 25
+
+struct stats_histogram {
+	uint64_t count;
+	uint64_t total_us;
+	uint64_t max_us;
+	uint64_t buckets[STATS_HISTOGRAM_BUCKETS];
+};
+
+extern uint64_t stats_counters[STATS_COUNTER_COUNT];
+
+/** Handling time of GDB packets, indexed by the packet type character */
+extern struct stats_histogram stats_gdb_packets[128];
+
+/** Time spent in each invocation of a timer callback */
+extern struct stats_histogram stats_timer_callbacks;
+
+static inline void stats_add(enum stats_counter counter, uint64_t value)
+{
+	stats_counters[counter] += value;
+}
+
+void stats_histogram_add(struct stats_histogram *histogram, uint64_t us);
+void stats_print(struct command_invocation *cmd);
+void stats_reset(void);
+
+#endif /* OPENOCD_HELPER_STATS_H */
@@ -26,6 +26,7 @@
 #include <transport/transport.h>
 #include <helper/jep106.h>
 #include "helper/system.h"
+#include "helper/stats.h"
 
 #ifdef HAVE_STRINGS_H
 #include <strings.h>
@@ -952,6 +953,12 @@ int default_interface_jtag_execute_queue(void)
 	}
 
 	struct jtag_command *cmd = jtag_command_queue_get();
+
+	for (struct jtag_command *c = cmd; c; c = c->next) {
+		if (c->type == JTAG_SCAN)
+			stats_add(STATS_JTAG_SCAN_BITS, jtag_scan_size(c->cmd.scan));
+	}
+
 	int result = adapter_driver->jtag_ops->execute_queue(cmd);
 
 	while (debug_level >= LOG_LVL_DEBUG_IO && cmd) {
@@ -1018,6 +1025,7 @@ int default_interface_jtag_execute_queue(void)
 void jtag_execute_queue_noclear(void)
 {
 	jtag_flush_queue_count++;
+	stats_add(STATS_JTAG_FLUSHES, 1);
 	jtag_set_error(interface_jtag_execute_queue());
 
 	if (jtag_flush_queue_sleep > 0) {
@@ -1580,6 +1588,20 @@ int jtag_init_inner(struct command_context *cmd_ctx)
 	return ERROR_OK;
 }
 
+/* WAIT acknowledges decoded by the SWD driver, see swd_wait_count() */
+static unsigned int swd_waits;
+
+void swd_count_wait(void)
+{
+	swd_waits++;
+	stats_add(STATS_DAP_WAITS, 1);
+}
+
+unsigned int swd_wait_count(void)
+{
+	return swd_waits;
+}
+
 int swd_init_reset(struct command_context *cmd_ctx)
 {
 	int retval, retval1;
@@ -499,6 +499,8 @@ static void bitbang_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay
 			(cmd & SWD_CMD_A32) >> 1,
 			data);
 
+		if (ack == SWD_ACK_WAIT)
+			swd_count_wait();
 		if (ack == SWD_ACK_WAIT && timeval_ms() <= timeout) {
 			swd_clear_sticky_errors();
 			if (retry > 20)
@@ -577,6 +579,8 @@ static void bitbang_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay
 			(cmd & SWD_CMD_A32) >> 1,
 			buf_get_u32(trn_ack_data_parity_trn, 1 + 3 + 1, 32));
 
+		if (check_ack && ack == SWD_ACK_WAIT)
+			swd_count_wait();
 		if (check_ack && ack == SWD_ACK_WAIT && timeval_ms() <= timeout) {
 			swd_clear_sticky_errors();
 			if (retry > 20)
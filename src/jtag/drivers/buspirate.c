@@ -1455,6 +1455,7 @@ static void buspirate_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_del
 		return;
 	case SWD_ACK_WAIT:
 		LOG_DEBUG("SWD_ACK_WAIT");
+		swd_count_wait();
 		buspirate_swd_clear_sticky_errors();
 		return;
 	case SWD_ACK_FAULT:
@@ -1506,6 +1507,7 @@ static void buspirate_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_del
 		return;
 	case SWD_ACK_WAIT:
 		LOG_DEBUG("SWD_ACK_WAIT");
+		swd_count_wait();
 		buspirate_swd_clear_sticky_errors();
 		return;
 	case SWD_ACK_FAULT:
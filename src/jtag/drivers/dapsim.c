@@ -0,0 +1,616 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * Simulated SWD debug port.
+ *
+ * The driver implements an ADIv5 SW-DP with a single AHB MEM-AP in process,
+ * backed by RAM and flash regions held in host memory. Queue flush latency
+ * and WAIT/FAULT responses can be injected, so the DAP, target, flash and
+ * server layers can be exercised and benchmarked without any hardware.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <jtag/interface.h>
+#include <jtag/swd.h>
+#include <jtag/commands.h>
+#include <target/arm_adi_v5.h>
+
+#define DAPSIM_DPIDR		0x2ba01477	/* ARM SW-DP, DPv1 */
+#define DAPSIM_AP_IDR		0x24770011	/* ARM AHB3-AP */
+#define DAPSIM_AP_BASE		0x00000002	/* no debug entry present */
+
+#define DAPSIM_DEFAULT_RAM_ADDRESS	0x20000000
+#define DAPSIM_DEFAULT_RAM_SIZE		0x10000
+
+/* MEM-AP auto-increment is only guaranteed within a 1 KiB block */
+#define DAPSIM_TAR_AUTOINC_BLOCK	0x400
+
+#define DAPSIM_STICKY_BITS	(SSTICKYORUN | SSTICKYCMP | SSTICKYERR | WDATAERR)
+
+enum dapsim_memory_type {
+	DAPSIM_RAM,
+	DAPSIM_FLASH,
+};
+
+struct dapsim_region {
+	uint32_t address;
+	uint32_t size;
+	enum dapsim_memory_type type;
+	uint8_t *data;
+	struct dapsim_region *next;
+};
+
+static struct dapsim_region *dapsim_regions;
+
+/* DP registers */
+static uint32_t dapsim_ctrl_stat;
+static uint32_t dapsim_select;
+static uint32_t dapsim_rdbuff;
+
+/* MEM-AP registers */
+static uint32_t dapsim_csw;
+static uint32_t dapsim_tar;
+
+/* Injected behaviour */
+static unsigned int dapsim_run_latency_us;
+static unsigned int dapsim_transfer_latency_ns;
+static unsigned int dapsim_wait_count;
+static unsigned int dapsim_fault_count;
+
+/* Statistics */
+static unsigned int dapsim_pending;
+static uint64_t dapsim_transactions;
+static uint64_t dapsim_runs;
+static uint64_t dapsim_waits;
+static uint64_t dapsim_faults;
+
+static int queued_retval;
+
+static const char * const dapsim_memory_type_names[] = {
+	[DAPSIM_RAM] = "ram",
+	[DAPSIM_FLASH] = "flash",
+};
+
+static struct dapsim_region *dapsim_find_region(uint32_t address, uint32_t size)
+{
+	for (struct dapsim_region *r = dapsim_regions; r; r = r->next) {
+		if (address >= r->address && (uint64_t)address + size <= (uint64_t)r->address + r->size)
+			return r;
+	}
+
+	return NULL;
+}
+
+static int dapsim_add_region(uint32_t address, uint32_t size, enum dapsim_memory_type type)
+{
+	for (struct dapsim_region *r = dapsim_regions; r; r = r->next) {
+		if ((uint64_t)address < (uint64_t)r->address + r->size &&
+				(uint64_t)r->address < (uint64_t)address + size) {
+			LOG_ERROR("dapsim: region at 0x%08" PRIx32 " overlaps region at 0x%08" PRIx32,
+				address, r->address);
+			return ERROR_FAIL;
+		}
+	}
+
+	struct dapsim_region *region = calloc(1, sizeof(*region));
+	if (!region) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	region->data = malloc(size);
+	if (!region->data) {
+		LOG_ERROR("Out of memory");
+		free(region);
+		return ERROR_FAIL;
+	}
+
+	/* Flash starts out erased */
+	memset(region->data, type == DAPSIM_FLASH ? 0xff : 0x00, size);
+	region->address = address;
+	region->size = size;
+	region->type = type;
+	region->next = dapsim_regions;
+	dapsim_regions = region;
+
+	return ERROR_OK;
+}
+
+static void dapsim_free_regions(void)
+{
+	while (dapsim_regions) {
+		struct dapsim_region *next = dapsim_regions->next;
+		free(dapsim_regions->data);
+		free(dapsim_regions);
+		dapsim_regions = next;
+	}
+}
+
+/**
+ * Perform one bus access of the MEM-AP. Data is placed on the byte lanes
+ * selected by the address, as on AHB. Writes to flash can only clear bits,
+ * like programming a NOR array.
+ *
+ * @return false on a bus error.
+ */
+static bool dapsim_bus_access(uint32_t address, unsigned int size, uint32_t *value, bool write)
+{
+	address &= ~(size - 1);
+
+	struct dapsim_region *region = dapsim_find_region(address, size);
+	if (!region)
+		return false;
+
+	uint8_t *data = region->data + (address - region->address);
+
+	if (!write)
+		*value = 0;
+
+	for (unsigned int i = 0; i < size; i++) {
+		unsigned int shift = 8 * ((address + i) & 3);
+		if (!write)
+			*value |= (uint32_t)data[i] << shift;
+		else if (region->type == DAPSIM_FLASH)
+			data[i] &= *value >> shift;
+		else
+			data[i] = *value >> shift;
+	}
+
+	return true;
+}
+
+static void dapsim_data_access(uint32_t address, unsigned int size, uint32_t *value, bool write)
+{
+	if (dapsim_fault_count) {
+		dapsim_fault_count--;
+		dapsim_ctrl_stat |= SSTICKYERR;
+		return;
+	}
+
+	if (!dapsim_bus_access(address, size, value, write)) {
+		LOG_DEBUG_IO("dapsim: bus error at 0x%08" PRIx32, address);
+		dapsim_ctrl_stat |= SSTICKYERR;
+		if (!write)
+			*value = 0;
+	}
+}
+
+static uint32_t dapsim_ap_access(unsigned int reg, uint32_t value, bool write)
+{
+	unsigned int size = 1 << (dapsim_csw & CSW_SIZE_MASK);
+
+	/* Only AP #0 is implemented, everything else reads as absent */
+	if (dapsim_select & ADIV5_DP_SELECT_APSEL)
+		return 0;
+
+	switch (reg) {
+	case ADIV5_MEM_AP_REG_CSW:
+		if (write) {
+			/* Only byte, halfword and word accesses, no packed transfers */
+			if ((value & CSW_SIZE_MASK) > CSW_32BIT)
+				value = (value & ~CSW_SIZE_MASK) | CSW_32BIT;
+			if ((value & CSW_ADDRINC_MASK) == CSW_ADDRINC_PACKED)
+				value = (value & ~CSW_ADDRINC_MASK) | CSW_ADDRINC_SINGLE;
+			dapsim_csw = value & ~CSW_DEVICE_EN;
+		}
+		return dapsim_csw | CSW_DEVICE_EN;
+
+	case ADIV5_MEM_AP_REG_TAR:
+		if (write)
+			dapsim_tar = value;
+		return dapsim_tar;
+
+	case ADIV5_MEM_AP_REG_DRW:
+		dapsim_data_access(dapsim_tar, size, &value, write);
+		if ((dapsim_csw & CSW_ADDRINC_MASK) != CSW_ADDRINC_OFF)
+			dapsim_tar = (dapsim_tar & ~(DAPSIM_TAR_AUTOINC_BLOCK - 1)) |
+				((dapsim_tar + size) & (DAPSIM_TAR_AUTOINC_BLOCK - 1));
+		return value;
+
+	case ADIV5_MEM_AP_REG_BD0:
+	case ADIV5_MEM_AP_REG_BD1:
+	case ADIV5_MEM_AP_REG_BD2:
+	case ADIV5_MEM_AP_REG_BD3:
+		dapsim_data_access((dapsim_tar & ~0xf) | (reg & 0xc), 4, &value, write);
+		return value;
+
+	case ADIV5_MEM_AP_REG_BASE:
+		return DAPSIM_AP_BASE;
+
+	case ADIV5_AP_REG_IDR:
+		return DAPSIM_AP_IDR;
+
+	default:
+		return 0;
+	}
+}
+
+static uint32_t dapsim_dp_read(unsigned int reg)
+{
+	switch (reg) {
+	case 0x0:
+		return DAPSIM_DPIDR;
+	case 0x4:
+		if (dapsim_select & DP_SELECT_DPBANK)
+			return 0;
+		return dapsim_ctrl_stat;
+	case 0x8:	/* RESEND */
+	case 0xc:	/* RDBUFF */
+	default:
+		return dapsim_rdbuff;
+	}
+}
+
+static void dapsim_dp_write(unsigned int reg, uint32_t value)
+{
+	switch (reg) {
+	case 0x0:	/* ABORT */
+		if (value & STKCMPCLR)
+			dapsim_ctrl_stat &= ~SSTICKYCMP;
+		if (value & STKERRCLR)
+			dapsim_ctrl_stat &= ~SSTICKYERR;
+		if (value & WDERRCLR)
+			dapsim_ctrl_stat &= ~WDATAERR;
+		if (value & ORUNERRCLR)
+			dapsim_ctrl_stat &= ~SSTICKYORUN;
+		break;
+	case 0x4:
+		if (dapsim_select & DP_SELECT_DPBANK)
+			break;
+		/* Sticky flags are only cleared through ABORT, requests are acknowledged at once */
+		value &= ~(DAPSIM_STICKY_BITS | CDBGRSTACK | CDBGPWRUPACK | CSYSPWRUPACK);
+		value |= dapsim_ctrl_stat & DAPSIM_STICKY_BITS;
+		if (value & CDBGRSTREQ)
+			value |= CDBGRSTACK;
+		if (value & CDBGPWRUPREQ)
+			value |= CDBGPWRUPACK;
+		if (value & CSYSPWRUPREQ)
+			value |= CSYSPWRUPACK;
+		dapsim_ctrl_stat = value;
+		break;
+	case 0x8:
+		dapsim_select = value;
+		break;
+	case 0xc:	/* TARGETSEL, single drop only */
+	default:
+		break;
+	}
+}
+
+/**
+ * Execute one SWD transaction against the simulated DP.
+ *
+ * @return the SWD acknowledge.
+ */
+static uint8_t dapsim_transaction(uint8_t cmd, uint32_t *value)
+{
+	bool is_ap = cmd & SWD_CMD_APNDP;
+	bool is_read = cmd & SWD_CMD_RNW;
+	unsigned int reg = (cmd & SWD_CMD_A32) >> 1;
+
+	dapsim_transactions++;
+	dapsim_pending++;
+
+	if (is_ap) {
+		if (dapsim_wait_count) {
+			dapsim_wait_count--;
+			dapsim_waits++;
+			return SWD_ACK_WAIT;
+		}
+
+		if (dapsim_ctrl_stat & DAPSIM_STICKY_BITS) {
+			dapsim_faults++;
+			return SWD_ACK_FAULT;
+		}
+
+		reg |= dapsim_select & ADIV5_DP_SELECT_APBANK;
+		if (is_read) {
+			/* AP reads are posted, the data arrives with the next read */
+			*value = dapsim_rdbuff;
+			dapsim_rdbuff = dapsim_ap_access(reg, 0, false);
+		} else {
+			dapsim_ap_access(reg, *value, true);
+		}
+	} else {
+		if (is_read)
+			*value = dapsim_dp_read(reg);
+		else
+			dapsim_dp_write(reg, *value);
+	}
+
+	return SWD_ACK_OK;
+}
+
+static void dapsim_swd_transfer(uint8_t cmd, uint32_t *value)
+{
+	uint32_t data = value ? *value : 0;
+	uint8_t ack;
+
+	if (queued_retval != ERROR_OK) {
+		LOG_DEBUG("Skip dapsim transfer because queued_retval=%d", queued_retval);
+		return;
+	}
+
+	/* Injected WAITs are finite, retry like a real adapter would */
+	for (unsigned int retry = 0;; retry++) {
+		ack = dapsim_transaction(cmd, &data);
+		if (ack != SWD_ACK_WAIT)
+			break;
+		swd_count_wait();
+		if (retry == 0)
+			LOG_DEBUG("dapsim: WAIT on %s reg %X",
+				cmd & SWD_CMD_APNDP ? "AP" : "DP", (cmd & SWD_CMD_A32) >> 1);
+	}
+
+	LOG_DEBUG_IO("%s %s %s reg %X = %08" PRIx32,
+		ack == SWD_ACK_OK ? "OK" : "FAULT",
+		cmd & SWD_CMD_APNDP ? "AP" : "DP",
+		cmd & SWD_CMD_RNW ? "read" : "write",
+		(cmd & SWD_CMD_A32) >> 1,
+		data);
+
+	if (ack != SWD_ACK_OK && swd_cmd_returns_ack(cmd)) {
+		queued_retval = swd_ack_to_error_code(ack);
+		return;
+	}
+
+	if (value && (cmd & SWD_CMD_RNW))
+		*value = data;
+}
+
+static void dapsim_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay_clk)
+{
+	assert(cmd & SWD_CMD_RNW);
+	dapsim_swd_transfer(cmd, value);
+}
+
+static void dapsim_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_clk)
+{
+	assert(!(cmd & SWD_CMD_RNW));
+	dapsim_swd_transfer(cmd, &value);
+}
+
+static int dapsim_swd_run_queue(void)
+{
+	/* Model the adapter round trip plus the time on the wire */
+	uint64_t delay_us = dapsim_run_latency_us +
+		(uint64_t)dapsim_pending * dapsim_transfer_latency_ns / 1000;
+	if (delay_us)
+		jtag_sleep(delay_us);
+
+	dapsim_pending = 0;
+	dapsim_runs++;
+
+	int retval = queued_retval;
+	queued_retval = ERROR_OK;
+	LOG_DEBUG_IO("SWD queue return value: %02x", retval);
+	return retval;
+}
+
+static int dapsim_swd_switch_seq(enum swd_special_seq seq)
+{
+	switch (seq) {
+	case LINE_RESET:
+	case JTAG_TO_SWD:
+	case DORMANT_TO_SWD:
+		LOG_DEBUG_IO("dapsim: SWD line reset");
+		break;
+	case JTAG_TO_DORMANT:
+	case SWD_TO_JTAG:
+	case SWD_TO_DORMANT:
+	case DORMANT_TO_JTAG:
+		break;
+	default:
+		LOG_ERROR("Sequence %d not supported", seq);
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+static int dapsim_swd_init(void)
+{
+	return ERROR_OK;
+}
+
+static const struct swd_driver dapsim_swd = {
+	.init = dapsim_swd_init,
+	.switch_seq = dapsim_swd_switch_seq,
+	.read_reg = dapsim_swd_read_reg,
+	.write_reg = dapsim_swd_write_reg,
+	.run = dapsim_swd_run_queue,
+};
+
+static int dapsim_init(void)
+{
+	if (!dapsim_regions) {
+		int retval = dapsim_add_region(DAPSIM_DEFAULT_RAM_ADDRESS,
+				DAPSIM_DEFAULT_RAM_SIZE, DAPSIM_RAM);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	dapsim_ctrl_stat = 0;
+	dapsim_select = 0;
+	dapsim_rdbuff = 0;
+	dapsim_csw = 0;
+	dapsim_tar = 0;
+	queued_retval = ERROR_OK;
+
+	return ERROR_OK;
+}
+
+static int dapsim_quit(void)
+{
+	dapsim_free_regions();
+	return ERROR_OK;
+}
+
+static int dapsim_reset(int trst, int srst)
+{
+	return ERROR_OK;
+}
+
+static int dapsim_speed(int speed)
+{
+	return ERROR_OK;
+}
+
+static int dapsim_khz(int khz, int *jtag_speed)
+{
+	*jtag_speed = khz;
+	return ERROR_OK;
+}
+
+static int dapsim_speed_div(int speed, int *khz)
+{
+	*khz = speed;
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(dapsim_handle_memory_command)
+{
+	if (CMD_ARGC == 0) {
+		for (struct dapsim_region *r = dapsim_regions; r; r = r->next)
+			command_print(CMD, "0x%08" PRIx32 " 0x%08" PRIx32 " %s",
+				r->address, r->size, dapsim_memory_type_names[r->type]);
+		return ERROR_OK;
+	}
+
+	if (CMD_ARGC < 2 || CMD_ARGC > 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	uint32_t address, size;
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], address);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], size);
+	if (!size)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	enum dapsim_memory_type type = DAPSIM_RAM;
+	if (CMD_ARGC == 3) {
+		if (strcmp(CMD_ARGV[2], "flash") == 0)
+			type = DAPSIM_FLASH;
+		else if (strcmp(CMD_ARGV[2], "ram") != 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	return dapsim_add_region(address, size, type);
+}
+
+COMMAND_HANDLER(dapsim_handle_latency_command)
+{
+	if (CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC > 0)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], dapsim_run_latency_us);
+	if (CMD_ARGC > 1)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], dapsim_transfer_latency_ns);
+
+	command_print(CMD, "queue flush %u us, transaction %u ns",
+		dapsim_run_latency_us, dapsim_transfer_latency_ns);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(dapsim_handle_inject_command)
+{
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	unsigned int count;
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], count);
+
+	if (strcmp(CMD_ARGV[0], "wait") == 0)
+		dapsim_wait_count = count;
+	else if (strcmp(CMD_ARGV[0], "fault") == 0)
+		dapsim_fault_count = count;
+	else
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(dapsim_handle_stats_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "reset") != 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		dapsim_transactions = 0;
+		dapsim_runs = 0;
+		dapsim_waits = 0;
+		dapsim_faults = 0;
+		return ERROR_OK;
+	}
+
+	command_print(CMD, "transactions %" PRIu64 ", queue flushes %" PRIu64
+		", WAIT %" PRIu64 ", FAULT %" PRIu64,
+		dapsim_transactions, dapsim_runs, dapsim_waits, dapsim_faults);
+	return ERROR_OK;
+}
+
+static const struct command_registration dapsim_subcommand_handlers[] = {
+	{
+		.name = "memory",
+		.handler = &dapsim_handle_memory_command,
+		.mode = COMMAND_ANY,
+		.help = "add a memory region behind the MEM-AP, or list the regions",
+		.usage = "[address size ['ram'|'flash']]",
+	},
+	{
+		.name = "latency",
+		.handler = &dapsim_handle_latency_command,
+		.mode = COMMAND_ANY,
+		.help = "set the simulated latency of a queue flush and of each transaction",
+		.usage = "[flush_us [transaction_ns]]",
+	},
+	{
+		.name = "inject",
+		.handler = &dapsim_handle_inject_command,
+		.mode = COMMAND_EXEC,
+		.help = "answer the next AP transactions with WAIT, "
+			"or fail the next MEM-AP data accesses with a bus error",
+		.usage = "('wait'|'fault') count",
+	},
+	{
+		.name = "stats",
+		.handler = &dapsim_handle_stats_command,
+		.mode = COMMAND_EXEC,
+		.help = "show or reset the transaction counters",
+		.usage = "['reset']",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration dapsim_command_handlers[] = {
+	{
+		.name = "dapsim",
+		.mode = COMMAND_ANY,
+		.help = "simulated SWD debug port commands",
+		.chain = dapsim_subcommand_handlers,
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const char * const dapsim_transports[] = { "swd", NULL };
+
+struct adapter_driver dapsim_adapter_driver = {
+	.name = "dapsim",
+	.transports = dapsim_transports,
+	.commands = dapsim_command_handlers,
+
+	.init = &dapsim_init,
+	.quit = &dapsim_quit,
+	.reset = &dapsim_reset,
+	.speed = &dapsim_speed,
+	.khz = &dapsim_khz,
+	.speed_div = &dapsim_speed_div,
+
+	.swd_ops = &dapsim_swd,
+};
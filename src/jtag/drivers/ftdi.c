@@ -109,6 +109,7 @@ static struct signal *signals;
 static struct swd_cmd_queue_entry {
 	uint8_t cmd;
 	uint32_t *dst;
+	uint32_t ap_delay_clk;
 	uint8_t trn_ack_data_parity_trn[DIV_ROUND_UP(4 + 3 + 32 + 1 + 4, 8)];
 } *swd_cmd_queue;
 static size_t swd_cmd_queue_length;
@@ -116,12 +117,19 @@ static size_t swd_cmd_queue_alloced;
 static int queued_retval;
 static int freq;
 
+/* WAIT responses retried within one queue run, and idle cycles before the
+ * first retry. The idle cycles double with each further retry. */
+static unsigned int swd_wait_retries = 100;
+static unsigned int swd_wait_idle_cycles = 8;
+#define SWD_WAIT_IDLE_CYCLES_MAX 8192
+
 static uint16_t output;
 static uint16_t direction;
 static uint16_t jtag_output_init;
 static uint16_t jtag_direction_init;
 
 static int ftdi_swd_switch_seq(enum swd_special_seq seq);
+static void ftdi_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data, uint32_t ap_delay_clk);
 
 static struct signal *find_signal_by_name(const char *name)
 {
@@ -917,6 +925,22 @@ COMMAND_HANDLER(ftdi_handle_tdo_sample_edge_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(ftdi_handle_swd_wait_retry_command)
+{
+	if (CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC >= 1)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], swd_wait_retries);
+	if (CMD_ARGC == 2)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], swd_wait_idle_cycles);
+
+	command_print(CMD, "ftdi retries SWD WAIT up to %u times, after %u idle cycles",
+		swd_wait_retries, swd_wait_idle_cycles);
+
+	return ERROR_OK;
+}
+
 static const struct command_registration ftdi_subcommand_handlers[] = {
 	{
 		.name = "device_desc",
@@ -978,6 +1002,14 @@ static const struct command_registration ftdi_subcommand_handlers[] = {
 			"allow signalling speed increase)",
 		.usage = "(rising|falling)",
 	},
+	{
+		.name = "swd_wait_retry",
+		.handler = &ftdi_handle_swd_wait_retry_command,
+		.mode = COMMAND_ANY,
+		.help = "set how often a SWD transaction answered with WAIT is "
+			"retried within a queue run, and the idle cycles before a retry",
+		.usage = "[count [idle_cycles]]",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -1052,6 +1084,67 @@ static void ftdi_swd_swdio_en(bool enable)
 	}
 }
 
+/**
+ * Check if the transactions following a WAIT can be issued again.
+ * When overrun detection is enabled, the DP answers them with FAULT and
+ * ignores them. Only DP reads, which have no side effect, may go through.
+ */
+static bool ftdi_swd_can_retry(size_t wait_index)
+{
+	for (size_t i = wait_index + 1; i < swd_cmd_queue_length; i++) {
+		uint8_t cmd = swd_cmd_queue[i].cmd;
+		int ack = buf_get_u32(swd_cmd_queue[i].trn_ack_data_parity_trn, 1, 3);
+
+		if (!swd_cmd_returns_ack(cmd))
+			return false;
+		if (ack == SWD_ACK_OK && ((cmd & SWD_CMD_APNDP) || !(cmd & SWD_CMD_RNW)))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Queue again the transactions from @a first on, behind an ABORT clearing
+ * the overrun flag and @a idle_cycles idle cycles to let the AP complete.
+ */
+static int ftdi_swd_requeue(size_t first, unsigned int idle_cycles)
+{
+	size_t count = swd_cmd_queue_length - first;
+
+	struct swd_cmd_queue_entry *pending = malloc(count * sizeof(*pending));
+	if (!pending) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	memcpy(pending, &swd_cmd_queue[first], count * sizeof(*pending));
+
+	/* Make room for the ABORT, ftdi_swd_queue_cmd() must not run the queue */
+	if (count + 1 > swd_cmd_queue_alloced) {
+		struct swd_cmd_queue_entry *q = realloc(swd_cmd_queue, swd_cmd_queue_alloced * 2 * sizeof(*swd_cmd_queue));
+		if (!q) {
+			LOG_ERROR("Out of memory");
+			free(pending);
+			return ERROR_FAIL;
+		}
+		swd_cmd_queue = q;
+		swd_cmd_queue_alloced *= 2;
+	}
+
+	swd_cmd_queue_length = 0;
+
+	ftdi_swd_queue_cmd(swd_cmd(false, false, DP_ABORT), NULL, ORUNERRCLR, 0);
+	mpsse_clock_data_out(mpsse_ctx, NULL, 0, idle_cycles, SWD_MODE);
+
+	for (size_t i = 0; i < count; i++) {
+		uint32_t data = buf_get_u32(pending[i].trn_ack_data_parity_trn, 1 + 3 + 1, 32);
+		ftdi_swd_queue_cmd(pending[i].cmd, pending[i].dst, data, pending[i].ap_delay_clk);
+	}
+
+	free(pending);
+	return ERROR_OK;
+}
+
 /**
  * Flush the MPSSE queue and process the SWD transaction queue
  * @return
@@ -1061,12 +1154,14 @@ static int ftdi_swd_run_queue(void)
 	LOG_DEBUG_IO("Executing %zu queued transactions", swd_cmd_queue_length);
 	int retval;
 	struct signal *led = find_signal_by_name("LED");
+	unsigned int wait_retries = 0;
 
 	if (queued_retval != ERROR_OK) {
 		LOG_DEBUG_IO("Skipping due to previous errors: %d", queued_retval);
 		goto skip;
 	}
 
+retry:
 	/* A transaction must be followed by another transaction or at least 8 idle cycles to
 	 * ensure that data is clocked through the AP. */
 	mpsse_clock_data_out(mpsse_ctx, NULL, 0, 8, SWD_MODE);
@@ -1097,7 +1192,24 @@ static int ftdi_swd_run_queue(void)
 				buf_get_u32(swd_cmd_queue[i].trn_ack_data_parity_trn,
 						1 + 3 + (swd_cmd_queue[i].cmd & SWD_CMD_RNW ? 0 : 1), 32));
 
-		if (ack != SWD_ACK_OK && check_ack) {
+		if (ack == SWD_ACK_WAIT && check_ack)
+			swd_count_wait();
+
+		if (ack == SWD_ACK_WAIT && check_ack && wait_retries < swd_wait_retries
+				&& ftdi_swd_can_retry(i)) {
+			/* Transactions up to here are complete, issue the rest again */
+			unsigned int idle_cycles = swd_wait_idle_cycles;
+			for (unsigned int n = 0; n < wait_retries && idle_cycles < SWD_WAIT_IDLE_CYCLES_MAX; n++)
+				idle_cycles *= 2;
+
+			wait_retries++;
+
+			queued_retval = ftdi_swd_requeue(i, MIN(idle_cycles, SWD_WAIT_IDLE_CYCLES_MAX));
+			if (queued_retval != ERROR_OK)
+				goto skip;
+			goto retry;
+
+		} else if (ack != SWD_ACK_OK && check_ack) {
 			queued_retval = swd_ack_to_error_code(ack);
 			goto skip;
 
@@ -1116,6 +1228,9 @@ static int ftdi_swd_run_queue(void)
 		}
 	}
 
+	if (wait_retries)
+		LOG_DEBUG("SWD WAIT: retried %u times", wait_retries);
+
 skip:
 	swd_cmd_queue_length = 0;
 	retval = queued_retval;
@@ -1148,6 +1263,7 @@ static void ftdi_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data, uint32
 
 	size_t i = swd_cmd_queue_length++;
 	swd_cmd_queue[i].cmd = cmd | SWD_CMD_START | SWD_CMD_PARK;
+	swd_cmd_queue[i].ap_delay_clk = ap_delay_clk;
 
 	mpsse_clock_data_out(mpsse_ctx, &swd_cmd_queue[i].cmd, 0, 8, SWD_MODE);
 
@@ -779,6 +779,8 @@ static int kitprog_swd_run_queue(void)
 			}
 
 			uint8_t ack = buffer[read_index] & 0x07;
+			if (ack == SWD_ACK_WAIT)
+				swd_count_wait();
 			if (ack != SWD_ACK_OK || (buffer[read_index] & 0x08)) {
 				LOG_DEBUG("SWD ack not OK: %d %s", i,
 					  ack == SWD_ACK_WAIT ? "WAIT" : ack == SWD_ACK_FAULT ? "FAULT" : "JUNK");
@@ -378,6 +378,159 @@ int jtag_libusb_handle_events_completed(int *completed)
 	return libusb_handle_events_completed(jtag_libusb_context, completed);
 }
 
+struct jtag_libusb_bulk_xfer {
+	struct libusb_transfer *transfer;
+	int completed;
+	int *transferred;
+};
+
+struct jtag_libusb_bulk_queue {
+	struct libusb_device_handle *devh;
+	int timeout;
+	/* ring of transfers, the in flight ones start at first */
+	struct jtag_libusb_bulk_xfer *xfers;
+	unsigned int depth;
+	unsigned int first;
+	unsigned int count;
+	/* first error since the last wait */
+	int retval;
+};
+
+static LIBUSB_CALL void jtag_libusb_bulk_queue_cb(struct libusb_transfer *transfer)
+{
+	int *completed = transfer->user_data;
+	*completed = 1;
+}
+
+static int jtag_libusb_transfer_status(const struct libusb_transfer *transfer)
+{
+	switch (transfer->status) {
+	case LIBUSB_TRANSFER_COMPLETED:
+		return ERROR_OK;
+	case LIBUSB_TRANSFER_TIMED_OUT:
+		return jtag_libusb_error(LIBUSB_ERROR_TIMEOUT);
+	case LIBUSB_TRANSFER_STALL:
+		return jtag_libusb_error(LIBUSB_ERROR_PIPE);
+	case LIBUSB_TRANSFER_OVERFLOW:
+		return jtag_libusb_error(LIBUSB_ERROR_OVERFLOW);
+	case LIBUSB_TRANSFER_NO_DEVICE:
+		return jtag_libusb_error(LIBUSB_ERROR_NO_DEVICE);
+	default:
+		return jtag_libusb_error(LIBUSB_ERROR_IO);
+	}
+}
+
+/* Wait for the oldest transfer in flight and retire it */
+static void jtag_libusb_bulk_queue_complete(struct jtag_libusb_bulk_queue *queue)
+{
+	struct jtag_libusb_bulk_xfer *xfer = &queue->xfers[queue->first];
+
+	while (!xfer->completed) {
+		int r = jtag_libusb_handle_events_completed(&xfer->completed);
+		if (r < 0 && r != LIBUSB_ERROR_INTERRUPTED)
+			libusb_cancel_transfer(xfer->transfer);
+	}
+
+	int retval = jtag_libusb_transfer_status(xfer->transfer);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("libusb bulk transfer on endpoint 0x%02x failed: %d",
+			xfer->transfer->endpoint, xfer->transfer->status);
+		if (queue->retval == ERROR_OK)
+			queue->retval = retval;
+	} else if (xfer->transferred) {
+		*xfer->transferred = xfer->transfer->actual_length;
+	}
+
+	queue->first = (queue->first + 1) % queue->depth;
+	queue->count--;
+}
+
+struct jtag_libusb_bulk_queue *jtag_libusb_bulk_queue_new(struct libusb_device_handle *devh,
+		unsigned int depth, int timeout)
+{
+	struct jtag_libusb_bulk_queue *queue = calloc(1, sizeof(*queue));
+	if (!queue)
+		return NULL;
+
+	queue->xfers = calloc(depth, sizeof(*queue->xfers));
+	if (!queue->xfers) {
+		free(queue);
+		return NULL;
+	}
+
+	queue->devh = devh;
+	queue->timeout = timeout;
+	queue->depth = depth;
+
+	/* transfers are allocated once and reused for every submission */
+	for (unsigned int i = 0; i < depth; i++) {
+		queue->xfers[i].transfer = libusb_alloc_transfer(0);
+		if (!queue->xfers[i].transfer) {
+			jtag_libusb_bulk_queue_free(queue);
+			return NULL;
+		}
+	}
+
+	return queue;
+}
+
+void jtag_libusb_bulk_queue_free(struct jtag_libusb_bulk_queue *queue)
+{
+	if (!queue)
+		return;
+
+	jtag_libusb_bulk_queue_wait(queue);
+
+	for (unsigned int i = 0; i < queue->depth; i++)
+		libusb_free_transfer(queue->xfers[i].transfer);
+	free(queue->xfers);
+	free(queue);
+}
+
+int jtag_libusb_bulk_queue_submit(struct jtag_libusb_bulk_queue *queue,
+		int ep, uint8_t *buf, int size, int *transferred)
+{
+	if (queue->retval != ERROR_OK)
+		return queue->retval;
+
+	if (queue->count == queue->depth) {
+		jtag_libusb_bulk_queue_complete(queue);
+		if (queue->retval != ERROR_OK)
+			return queue->retval;
+	}
+
+	struct jtag_libusb_bulk_xfer *xfer =
+		&queue->xfers[(queue->first + queue->count) % queue->depth];
+
+	xfer->completed = 0;
+	xfer->transferred = transferred;
+	if (transferred)
+		*transferred = 0;
+
+	libusb_fill_bulk_transfer(xfer->transfer, queue->devh, ep, buf, size,
+		jtag_libusb_bulk_queue_cb, &xfer->completed, queue->timeout);
+
+	int r = libusb_submit_transfer(xfer->transfer);
+	if (r != LIBUSB_SUCCESS) {
+		LOG_ERROR("libusb_submit_transfer error: %s", libusb_error_name(r));
+		queue->retval = jtag_libusb_error(r);
+		return queue->retval;
+	}
+
+	queue->count++;
+	return ERROR_OK;
+}
+
+int jtag_libusb_bulk_queue_wait(struct jtag_libusb_bulk_queue *queue)
+{
+	while (queue->count)
+		jtag_libusb_bulk_queue_complete(queue);
+
+	int retval = queue->retval;
+	queue->retval = ERROR_OK;
+	return retval;
+}
+
 static enum {
 	DEV_MEM_NOT_YET_DECIDED,
 	DEV_MEM_AVAILABLE,
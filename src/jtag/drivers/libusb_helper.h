@@ -67,6 +67,52 @@ int jtag_libusb_choose_interface(struct libusb_device_handle *devh,
 int jtag_libusb_get_pid(struct libusb_device *dev, uint16_t *pid);
 int jtag_libusb_handle_events_completed(int *completed);
 
+/**
+ * Queue of asynchronous bulk transfers on one device.
+ *
+ * Transfers are submitted without waiting for their completion, so that a
+ * driver can queue a command and the read of its result, or several
+ * commands, and pay for a single USB round trip. Up to @a depth transfers
+ * are in flight at once; submitting one more first waits for the oldest.
+ * The data buffers are not copied: they must stay valid until the transfer
+ * completes, and can be allocated with oocd_libusb_dev_mem_alloc() to
+ * avoid copies in the kernel as well.
+ */
+struct jtag_libusb_bulk_queue;
+
+/**
+ * Allocate a transfer queue.
+ * @param devh _libusb_ device handle.
+ * @param depth maximum number of transfers in flight.
+ * @param timeout of each transfer, in milliseconds.
+ * @returns the new queue, or NULL on failure.
+ */
+struct jtag_libusb_bulk_queue *jtag_libusb_bulk_queue_new(struct libusb_device_handle *devh,
+		unsigned int depth, int timeout);
+/** Wait for the transfers in flight, then free the queue. */
+void jtag_libusb_bulk_queue_free(struct jtag_libusb_bulk_queue *queue);
+/**
+ * Submit a bulk transfer; its direction is given by the endpoint.
+ * After a failure, further transfers are not submitted until the next
+ * call to jtag_libusb_bulk_queue_wait(), which reports the failure.
+ * @param queue the transfer queue.
+ * @param ep endpoint address.
+ * @param buf data buffer, which must stay valid until the transfer completes.
+ * @param size number of bytes to transfer.
+ * @param transferred where the number of bytes actually transferred is
+ *	stored when the transfer completes, or NULL.
+ * @returns ERROR_OK on success, or the error of a failed transfer.
+ */
+int jtag_libusb_bulk_queue_submit(struct jtag_libusb_bulk_queue *queue,
+		int ep, uint8_t *buf, int size, int *transferred);
+/**
+ * Wait for the completion of all the submitted transfers.
+ * @param queue the transfer queue.
+ * @returns ERROR_OK if they all succeeded, otherwise the error of the
+ *	first transfer that failed since the previous call.
+ */
+int jtag_libusb_bulk_queue_wait(struct jtag_libusb_bulk_queue *queue);
+
 /**
  * Attempts to allocate a block of persistent DMA memory suitable for transfers
  * against the USB device. Fall-back to the ordinary heap malloc()
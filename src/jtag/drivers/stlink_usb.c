@@ -143,8 +143,8 @@ struct stlink_usb_version {
 struct stlink_usb_priv {
 	/** */
 	struct libusb_device_handle *fd;
-	/** */
-	struct libusb_transfer *trans;
+	/** asynchronous transfers */
+	struct jtag_libusb_bulk_queue *queue;
 };
 
 struct stlink_tcp_version {
@@ -577,151 +577,6 @@ static unsigned int stlink_usb_block(void *handle)
 		return STLINK_MAX_RW8;
 }
 
-#ifdef USE_LIBUSB_ASYNCIO
-
-static LIBUSB_CALL void sync_transfer_cb(struct libusb_transfer *transfer)
-{
-	int *completed = transfer->user_data;
-	*completed = 1;
-	/* caller interprets result and frees transfer */
-}
-
-
-static void sync_transfer_wait_for_completion(struct libusb_transfer *transfer)
-{
-	int r, *completed = transfer->user_data;
-
-	while (!*completed) {
-		r = jtag_libusb_handle_events_completed(completed);
-		if (r < 0) {
-			if (r == LIBUSB_ERROR_INTERRUPTED)
-				continue;
-			libusb_cancel_transfer(transfer);
-			continue;
-		}
-	}
-}
-
-
-static int transfer_error_status(const struct libusb_transfer *transfer)
-{
-	int r = 0;
-
-	switch (transfer->status) {
-		case LIBUSB_TRANSFER_COMPLETED:
-			r = 0;
-			break;
-		case LIBUSB_TRANSFER_TIMED_OUT:
-			r = LIBUSB_ERROR_TIMEOUT;
-			break;
-		case LIBUSB_TRANSFER_STALL:
-			r = LIBUSB_ERROR_PIPE;
-			break;
-		case LIBUSB_TRANSFER_OVERFLOW:
-			r = LIBUSB_ERROR_OVERFLOW;
-			break;
-		case LIBUSB_TRANSFER_NO_DEVICE:
-			r = LIBUSB_ERROR_NO_DEVICE;
-			break;
-		case LIBUSB_TRANSFER_ERROR:
-		case LIBUSB_TRANSFER_CANCELLED:
-			r = LIBUSB_ERROR_IO;
-			break;
-		default:
-			r = LIBUSB_ERROR_OTHER;
-			break;
-	}
-
-	return r;
-}
-
-struct jtag_xfer {
-	int ep;
-	uint8_t *buf;
-	size_t size;
-	/* Internal */
-	int retval;
-	int completed;
-	size_t transfer_size;
-	struct libusb_transfer *transfer;
-};
-
-static int jtag_libusb_bulk_transfer_n(
-		struct libusb_device_handle *dev_handle,
-		struct jtag_xfer *transfers,
-		size_t n_transfers,
-		int timeout)
-{
-	int retval = 0;
-	int returnval = ERROR_OK;
-
-
-	for (size_t i = 0; i < n_transfers; ++i) {
-		transfers[i].retval = 0;
-		transfers[i].completed = 0;
-		transfers[i].transfer_size = 0;
-		transfers[i].transfer = libusb_alloc_transfer(0);
-
-		if (!transfers[i].transfer) {
-			for (size_t j = 0; j < i; ++j)
-				libusb_free_transfer(transfers[j].transfer);
-
-			LOG_DEBUG("ERROR, failed to alloc usb transfers");
-			for (size_t k = 0; k < n_transfers; ++k)
-				transfers[k].retval = LIBUSB_ERROR_NO_MEM;
-			return ERROR_FAIL;
-		}
-	}
-
-	for (size_t i = 0; i < n_transfers; ++i) {
-		libusb_fill_bulk_transfer(
-				transfers[i].transfer,
-				dev_handle,
-				transfers[i].ep, transfers[i].buf, transfers[i].size,
-				sync_transfer_cb, &transfers[i].completed, timeout);
-		transfers[i].transfer->type = LIBUSB_TRANSFER_TYPE_BULK;
-
-		retval = libusb_submit_transfer(transfers[i].transfer);
-		if (retval < 0) {
-			LOG_DEBUG("ERROR, failed to submit transfer %zu, error %d", i, retval);
-
-			/* Probably no point continuing to submit transfers once a submission fails.
-			 * As a result, tag all remaining transfers as errors.
-			 */
-			for (size_t j = i; j < n_transfers; ++j)
-				transfers[j].retval = retval;
-
-			returnval = ERROR_FAIL;
-			break;
-		}
-	}
-
-	/* Wait for every submitted USB transfer to complete.
-	*/
-	for (size_t i = 0; i < n_transfers; ++i) {
-		if (transfers[i].retval == 0) {
-			sync_transfer_wait_for_completion(transfers[i].transfer);
-
-			retval = transfer_error_status(transfers[i].transfer);
-			if (retval) {
-				returnval = ERROR_FAIL;
-				transfers[i].retval = retval;
-				LOG_DEBUG("ERROR, transfer %zu failed, error %d", i, retval);
-			} else {
-				/* Assuming actual_length is only valid if there is no transfer error.
-				 */
-				transfers[i].transfer_size = transfers[i].transfer->actual_length;
-			}
-		}
-
-		libusb_free_transfer(transfers[i].transfer);
-		transfers[i].transfer = NULL;
-	}
-
-	return returnval;
-}
-
-#endif
 
 
 /** */
@@ -766,36 +621,22 @@ static int stlink_usb_xfer_rw(void *handle, int cmdsize, const uint8_t *buf, int
 
 	assert(handle);
 
-	size_t n_transfers = 0;
-	struct jtag_xfer transfers[2];
-
-	memset(transfers, 0, sizeof(transfers));
-
-	transfers[0].ep = h->tx_ep;
-	transfers[0].buf = h->cmdbuf;
-	transfers[0].size = cmdsize;
-
-	++n_transfers;
-
-	if (h->direction == h->tx_ep && size) {
-		transfers[1].ep = h->tx_ep;
-		transfers[1].buf = (uint8_t *)buf;
-		transfers[1].size = size;
+	if (!h->usb_backend_priv.queue) {
+		h->usb_backend_priv.queue = jtag_libusb_bulk_queue_new(h->usb_backend_priv.fd,
+			2, STLINK_WRITE_TIMEOUT);
+		if (!h->usb_backend_priv.queue)
+			return ERROR_FAIL;
+	}
 
-		++n_transfers;
-	} else if (h->direction == h->rx_ep && size) {
-		transfers[1].ep = h->rx_ep;
-		transfers[1].buf = (uint8_t *)buf;
-		transfers[1].size = size;
+	/* the command and its data phase are in flight at the same time */
+	jtag_libusb_bulk_queue_submit(h->usb_backend_priv.queue, h->tx_ep,
+		h->cmdbuf, cmdsize, NULL);
 
-		++n_transfers;
-	}
+	if ((h->direction == h->tx_ep || h->direction == h->rx_ep) && size)
+		jtag_libusb_bulk_queue_submit(h->usb_backend_priv.queue, h->direction,
+			(uint8_t *)buf, size, NULL);
 
-	return jtag_libusb_bulk_transfer_n(
-			h->usb_backend_priv.fd,
-			transfers,
-			n_transfers,
-			STLINK_WRITE_TIMEOUT);
+	return jtag_libusb_bulk_queue_wait(h->usb_backend_priv.queue);
 }
 #else
 static int stlink_usb_xfer_rw(void *handle, int cmdsize, const uint8_t *buf, int size)
@@ -3250,6 +3091,7 @@ static int stlink_usb_usb_close(void *handle)
 		stlink_usb_exit_mode(h);
 		/* do not check return code, it prevent
 		us from closing jtag_libusb */
+		jtag_libusb_bulk_queue_free(h->usb_backend_priv.queue);
 		jtag_libusb_close(h->usb_backend_priv.fd);
 	}
 
@@ -3482,6 +3324,8 @@ static int stlink_usb_usb_open(void *handle, struct hl_interface_param *param)
 				return ERROR_FAIL;
 			}
 
+			jtag_libusb_bulk_queue_free(h->usb_backend_priv.queue);
+			h->usb_backend_priv.queue = NULL;
 			jtag_libusb_close(h->usb_backend_priv.fd);
 			/*
 			  Give the device one second to settle down and
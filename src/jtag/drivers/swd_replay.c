@@ -0,0 +1,373 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * SWD trace replay.
+ *
+ * Plays back a trace written by "swd record": every SWD call issued by
+ * OpenOCD is checked against the next record of the trace, and reads and
+ * queue runs return the recorded results. As long as OpenOCD issues the
+ * same transactions as in the recorded session, the session is reproduced
+ * exactly, without any hardware.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <jtag/interface.h>
+#include <jtag/swd.h>
+#include <jtag/swd_trace.h>
+#include <jtag/commands.h>
+#include <helper/time_support.h>
+
+static char *swd_replay_filename;
+static FILE *swd_replay_file;
+static bool swd_replay_timing;
+
+/* Set once the session departs from the trace, all further calls fail */
+static bool swd_replay_diverged;
+
+/* Reads queued since the last run, filled from the next run record */
+static uint32_t **swd_replay_reads;
+static unsigned int swd_replay_reads_count;
+static unsigned int swd_replay_reads_size;
+
+static int queued_retval;
+
+static uint64_t swd_replay_records;
+
+static bool swd_replay_get_u8(uint8_t *value)
+{
+	return fread(value, 1, 1, swd_replay_file) == 1;
+}
+
+static bool swd_replay_get_u32(uint32_t *value)
+{
+	uint8_t buf[4];
+
+	if (fread(buf, 1, sizeof(buf), swd_replay_file) != sizeof(buf))
+		return false;
+
+	*value = le_to_h_u32(buf);
+	return true;
+}
+
+static void swd_replay_diverge(const char *reason)
+{
+	if (!swd_replay_diverged)
+		LOG_ERROR("swd_replay: %s at record %" PRIu64 " of \"%s\"",
+			reason, swd_replay_records, swd_replay_filename);
+
+	swd_replay_diverged = true;
+	queued_retval = ERROR_FAIL;
+}
+
+/* Consume the type byte of the next record, which must be @a type */
+static bool swd_replay_expect(enum swd_trace_record type)
+{
+	uint8_t record;
+
+	if (swd_replay_diverged)
+		return false;
+
+	if (!swd_replay_get_u8(&record)) {
+		swd_replay_diverge("end of trace reached");
+		return false;
+	}
+
+	if (record != type) {
+		swd_replay_diverge("session departs from the trace");
+		return false;
+	}
+
+	swd_replay_records++;
+	return true;
+}
+
+static void swd_replay_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay_hint)
+{
+	uint8_t recorded_cmd;
+	uint32_t recorded_delay;
+
+	assert(cmd & SWD_CMD_RNW);
+
+	if (!swd_replay_expect(SWD_TRACE_READ))
+		return;
+
+	if (!swd_replay_get_u8(&recorded_cmd) || !swd_replay_get_u32(&recorded_delay)) {
+		swd_replay_diverge("truncated read record");
+		return;
+	}
+
+	if (recorded_cmd != cmd) {
+		swd_replay_diverge("read of a different register");
+		return;
+	}
+
+	if (swd_replay_reads_count == swd_replay_reads_size) {
+		unsigned int size = swd_replay_reads_size ? 2 * swd_replay_reads_size : 64;
+		uint32_t **reads = realloc(swd_replay_reads, size * sizeof(*reads));
+		if (!reads) {
+			LOG_ERROR("swd_replay: out of memory");
+			queued_retval = ERROR_FAIL;
+			return;
+		}
+		swd_replay_reads = reads;
+		swd_replay_reads_size = size;
+	}
+	swd_replay_reads[swd_replay_reads_count++] = value;
+}
+
+static void swd_replay_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_hint)
+{
+	uint8_t recorded_cmd;
+	uint32_t recorded_value, recorded_delay;
+
+	assert(!(cmd & SWD_CMD_RNW));
+
+	if (!swd_replay_expect(SWD_TRACE_WRITE))
+		return;
+
+	if (!swd_replay_get_u8(&recorded_cmd) || !swd_replay_get_u32(&recorded_value)
+			|| !swd_replay_get_u32(&recorded_delay)) {
+		swd_replay_diverge("truncated write record");
+		return;
+	}
+
+	if (recorded_cmd != cmd || recorded_value != value)
+		swd_replay_diverge("write of a different register or value");
+}
+
+static int swd_replay_run_queue(void)
+{
+	uint32_t result, elapsed_us, count;
+
+	if (!swd_replay_expect(SWD_TRACE_RUN)) {
+		swd_replay_reads_count = 0;
+		queued_retval = ERROR_OK;
+		return ERROR_FAIL;
+	}
+
+	if (!swd_replay_get_u32(&result) || !swd_replay_get_u32(&elapsed_us)
+			|| !swd_replay_get_u32(&count)) {
+		swd_replay_diverge("truncated run record");
+	} else if (count != swd_replay_reads_count) {
+		swd_replay_diverge("different number of reads in the queue");
+	} else {
+		for (unsigned int i = 0; i < count; i++) {
+			uint32_t value;
+			if (!swd_replay_get_u32(&value)) {
+				swd_replay_diverge("truncated run record");
+				break;
+			}
+			if (swd_replay_reads[i])
+				*swd_replay_reads[i] = value;
+		}
+	}
+
+	if (swd_replay_timing && elapsed_us)
+		jtag_sleep(elapsed_us);
+
+	swd_replay_reads_count = 0;
+
+	int retval = queued_retval;
+	queued_retval = ERROR_OK;
+	if (retval == ERROR_OK)
+		retval = (int32_t)result;
+
+	LOG_DEBUG_IO("SWD queue return value: %02x", retval);
+	return retval;
+}
+
+static int swd_replay_switch_seq(enum swd_special_seq seq)
+{
+	uint8_t recorded_seq;
+	uint32_t result;
+
+	if (!swd_replay_expect(SWD_TRACE_SWITCH_SEQ))
+		return ERROR_FAIL;
+
+	if (!swd_replay_get_u8(&recorded_seq) || !swd_replay_get_u32(&result)) {
+		swd_replay_diverge("truncated sequence record");
+		return ERROR_FAIL;
+	}
+
+	if (recorded_seq != seq) {
+		swd_replay_diverge("different SWD sequence");
+		return ERROR_FAIL;
+	}
+
+	return (int32_t)result;
+}
+
+static int swd_replay_swd_init(void)
+{
+	return ERROR_OK;
+}
+
+static const struct swd_driver swd_replay_swd = {
+	.init = swd_replay_swd_init,
+	.switch_seq = swd_replay_switch_seq,
+	.read_reg = swd_replay_read_reg,
+	.write_reg = swd_replay_write_reg,
+	.run = swd_replay_run_queue,
+};
+
+static int swd_replay_init(void)
+{
+	char magic[SWD_TRACE_MAGIC_SIZE];
+
+	if (!swd_replay_filename) {
+		LOG_ERROR("swd_replay: no trace file, use \"swd_replay file\"");
+		return ERROR_FAIL;
+	}
+
+	swd_replay_file = fopen(swd_replay_filename, "rb");
+	if (!swd_replay_file) {
+		LOG_ERROR("swd_replay: can't open \"%s\"", swd_replay_filename);
+		return ERROR_FAIL;
+	}
+
+	if (fread(magic, 1, sizeof(magic), swd_replay_file) != sizeof(magic)
+			|| memcmp(magic, SWD_TRACE_MAGIC, sizeof(magic))) {
+		LOG_ERROR("swd_replay: \"%s\" is not an SWD trace", swd_replay_filename);
+		fclose(swd_replay_file);
+		swd_replay_file = NULL;
+		return ERROR_FAIL;
+	}
+
+	swd_replay_diverged = false;
+	swd_replay_records = 0;
+	swd_replay_reads_count = 0;
+	queued_retval = ERROR_OK;
+
+	return ERROR_OK;
+}
+
+static int swd_replay_quit(void)
+{
+	if (swd_replay_file)
+		fclose(swd_replay_file);
+	swd_replay_file = NULL;
+
+	free(swd_replay_filename);
+	swd_replay_filename = NULL;
+
+	free(swd_replay_reads);
+	swd_replay_reads = NULL;
+	swd_replay_reads_size = 0;
+
+	return ERROR_OK;
+}
+
+static int swd_replay_reset(int trst, int srst)
+{
+	return ERROR_OK;
+}
+
+static int swd_replay_speed(int speed)
+{
+	return ERROR_OK;
+}
+
+static int swd_replay_khz(int khz, int *jtag_speed)
+{
+	*jtag_speed = khz;
+	return ERROR_OK;
+}
+
+static int swd_replay_speed_div(int speed, int *khz)
+{
+	*khz = speed;
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(swd_replay_handle_file_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	free(swd_replay_filename);
+	swd_replay_filename = strdup(CMD_ARGV[0]);
+	if (!swd_replay_filename) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(swd_replay_handle_timing_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[0], swd_replay_timing);
+
+	command_print(CMD, "swd_replay timing %s", swd_replay_timing ? "on" : "off");
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(swd_replay_handle_status_command)
+{
+	if (CMD_ARGC)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	command_print(CMD, "%" PRIu64 " records replayed%s", swd_replay_records,
+		swd_replay_diverged ? ", session departed from the trace" : "");
+	return ERROR_OK;
+}
+
+static const struct command_registration swd_replay_subcommand_handlers[] = {
+	{
+		.name = "file",
+		.handler = &swd_replay_handle_file_command,
+		.mode = COMMAND_CONFIG,
+		.help = "set the trace file to play back",
+		.usage = "filename",
+	},
+	{
+		.name = "timing",
+		.handler = &swd_replay_handle_timing_command,
+		.mode = COMMAND_ANY,
+		.help = "wait as long as the recorded adapter for each queue run",
+		.usage = "['on'|'off']",
+	},
+	{
+		.name = "status",
+		.handler = &swd_replay_handle_status_command,
+		.mode = COMMAND_EXEC,
+		.help = "show the replay progress",
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration swd_replay_command_handlers[] = {
+	{
+		.name = "swd_replay",
+		.mode = COMMAND_ANY,
+		.help = "SWD trace replay commands",
+		.chain = swd_replay_subcommand_handlers,
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const char * const swd_replay_transports[] = { "swd", NULL };
+
+struct adapter_driver swd_replay_adapter_driver = {
+	.name = "swd_replay",
+	.transports = swd_replay_transports,
+	.commands = swd_replay_command_handlers,
+
+	.init = &swd_replay_init,
+	.quit = &swd_replay_quit,
+	.reset = &swd_replay_reset,
+	.speed = &swd_replay_speed,
+	.khz = &swd_replay_khz,
+	.speed_div = &swd_replay_speed_div,
+
+	.swd_ops = &swd_replay_swd,
+};
@@ -588,6 +588,7 @@ static void xlnx_pcie_xvc_swd_read_reg(uint8_t cmd, uint32_t *value,
 		return;
 	case SWD_ACK_WAIT:
 		LOG_DEBUG_IO("SWD_ACK_WAIT");
+		swd_count_wait();
 		swd_clear_sticky_errors();
 		return;
 	case SWD_ACK_FAULT:
@@ -645,6 +646,7 @@ static void xlnx_pcie_xvc_swd_write_reg(uint8_t cmd, uint32_t value,
 		return;
 	case SWD_ACK_WAIT:
 		LOG_DEBUG_IO("SWD_ACK_WAIT");
+		swd_count_wait();
 		swd_clear_sticky_errors();
 		return;
 	case SWD_ACK_FAULT:
@@ -372,6 +372,7 @@ extern struct adapter_driver at91rm9200_adapter_driver;
 extern struct adapter_driver bcm2835gpio_adapter_driver;
 extern struct adapter_driver buspirate_adapter_driver;
 extern struct adapter_driver cmsis_dap_adapter_driver;
+extern struct adapter_driver dapsim_adapter_driver;
 extern struct adapter_driver dmem_dap_adapter_driver;
 extern struct adapter_driver dummy_adapter_driver;
 extern struct adapter_driver ep93xx_adapter_driver;
@@ -395,6 +396,7 @@ extern struct adapter_driver remote_bitbang_adapter_driver;
 extern struct adapter_driver rlink_adapter_driver;
 extern struct adapter_driver rshim_dap_adapter_driver;
 extern struct adapter_driver stlink_dap_adapter_driver;
+extern struct adapter_driver swd_replay_adapter_driver;
 extern struct adapter_driver sysfsgpio_adapter_driver;
 extern struct adapter_driver ulink_adapter_driver;
 extern struct adapter_driver usb_blaster_adapter_driver;
@@ -42,6 +42,12 @@ struct adapter_driver *adapter_drivers[] = {
 #if BUILD_DUMMY == 1
 		&dummy_adapter_driver,
 #endif
+#if BUILD_DAPSIM == 1
+		&dapsim_adapter_driver,
+#endif
+#if BUILD_SWD_REPLAY == 1
+		&swd_replay_adapter_driver,
+#endif
 #if BUILD_FTDI == 1
 		&ftdi_adapter_driver,
 #endif
@@ -308,4 +308,16 @@ struct swd_driver {
 
 int swd_init_reset(struct command_context *cmd_ctx);
 
+/**
+ * Count a WAIT acknowledge.  Called by the SWD drivers for each WAIT they
+ * decode, retried or not; the DAP layer does not count them again.
+ */
+void swd_count_wait(void);
+
+/**
+ * Number of WAIT acknowledges counted by swd_count_wait() so far.  Unlike
+ * the statistics counter, it is not reset by the user.
+ */
+unsigned int swd_wait_count(void);
+
 #endif /* OPENOCD_JTAG_SWD_H */
@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * Recording of SWD transactions.
+ *
+ * When enabled, the adapter's swd_driver is wrapped by a driver that writes
+ * every call and its outcome to a trace file before forwarding it. The trace
+ * can be played back with the "swd_replay" adapter driver, to reproduce a
+ * session without the hardware or to measure the host side overhead alone.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "swd_trace.h"
+#include <helper/log.h>
+#include <helper/time_support.h>
+
+static char *swd_trace_filename;
+static FILE *swd_trace_file;
+static const struct swd_driver *swd_trace_driver;
+
+/* Reads queued since the last run, their values are known after the run */
+static uint32_t **swd_trace_reads;
+static unsigned int swd_trace_reads_count;
+static unsigned int swd_trace_reads_size;
+
+/* Dummy destination for reads whose value the caller discards */
+static uint32_t swd_trace_discard;
+
+static void swd_trace_put(const uint8_t *data, size_t size)
+{
+	if (!swd_trace_file)
+		return;
+
+	if (fwrite(data, 1, size, swd_trace_file) != size) {
+		LOG_ERROR("SWD trace: write to \"%s\" failed, recording stopped",
+			swd_trace_filename);
+		fclose(swd_trace_file);
+		swd_trace_file = NULL;
+	}
+}
+
+static void swd_trace_put_u8(uint8_t value)
+{
+	swd_trace_put(&value, 1);
+}
+
+static void swd_trace_put_u32(uint32_t value)
+{
+	uint8_t buf[4];
+
+	h_u32_to_le(buf, value);
+	swd_trace_put(buf, sizeof(buf));
+}
+
+static int swd_trace_init(void)
+{
+	return swd_trace_driver->init();
+}
+
+static int swd_trace_switch_seq(enum swd_special_seq seq)
+{
+	int retval = swd_trace_driver->switch_seq(seq);
+
+	swd_trace_put_u8(SWD_TRACE_SWITCH_SEQ);
+	swd_trace_put_u8(seq);
+	swd_trace_put_u32(retval);
+
+	return retval;
+}
+
+static void swd_trace_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay_hint)
+{
+	if (!value)
+		value = &swd_trace_discard;
+
+	if (swd_trace_reads_count == swd_trace_reads_size) {
+		unsigned int size = swd_trace_reads_size ? 2 * swd_trace_reads_size : 64;
+		uint32_t **reads = realloc(swd_trace_reads, size * sizeof(*reads));
+		if (!reads) {
+			LOG_ERROR("SWD trace: out of memory, recording stopped");
+			swd_trace_record_stop();
+		} else {
+			swd_trace_reads = reads;
+			swd_trace_reads_size = size;
+		}
+	}
+	if (swd_trace_file)
+		swd_trace_reads[swd_trace_reads_count++] = value;
+
+	swd_trace_put_u8(SWD_TRACE_READ);
+	swd_trace_put_u8(cmd);
+	swd_trace_put_u32(ap_delay_hint);
+
+	swd_trace_driver->read_reg(cmd, value, ap_delay_hint);
+}
+
+static void swd_trace_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_hint)
+{
+	swd_trace_put_u8(SWD_TRACE_WRITE);
+	swd_trace_put_u8(cmd);
+	swd_trace_put_u32(value);
+	swd_trace_put_u32(ap_delay_hint);
+
+	swd_trace_driver->write_reg(cmd, value, ap_delay_hint);
+}
+
+static int swd_trace_run(void)
+{
+	struct duration elapsed;
+
+	duration_start(&elapsed);
+	int retval = swd_trace_driver->run();
+	duration_measure(&elapsed);
+
+	swd_trace_put_u8(SWD_TRACE_RUN);
+	swd_trace_put_u32(retval);
+	swd_trace_put_u32(duration_elapsed(&elapsed) * 1000000);
+	swd_trace_put_u32(swd_trace_reads_count);
+	for (unsigned int i = 0; i < swd_trace_reads_count; i++)
+		swd_trace_put_u32(*swd_trace_reads[i]);
+	swd_trace_reads_count = 0;
+
+	return retval;
+}
+
+static int *swd_trace_trace(bool swo)
+{
+	return swd_trace_driver->trace(swo);
+}
+
+static struct swd_driver swd_trace_ops = {
+	.init = swd_trace_init,
+	.switch_seq = swd_trace_switch_seq,
+	.read_reg = swd_trace_read_reg,
+	.write_reg = swd_trace_write_reg,
+	.run = swd_trace_run,
+};
+
+int swd_trace_record_start(const char *filename)
+{
+	swd_trace_record_stop();
+
+	swd_trace_file = fopen(filename, "wb");
+	if (!swd_trace_file) {
+		LOG_ERROR("SWD trace: can't create \"%s\"", filename);
+		return ERROR_FAIL;
+	}
+
+	swd_trace_filename = strdup(filename);
+	swd_trace_put((const uint8_t *)SWD_TRACE_MAGIC, SWD_TRACE_MAGIC_SIZE);
+
+	return ERROR_OK;
+}
+
+void swd_trace_record_stop(void)
+{
+	if (swd_trace_file)
+		fclose(swd_trace_file);
+	swd_trace_file = NULL;
+
+	free(swd_trace_filename);
+	swd_trace_filename = NULL;
+
+	free(swd_trace_reads);
+	swd_trace_reads = NULL;
+	swd_trace_reads_count = 0;
+	swd_trace_reads_size = 0;
+}
+
+const struct swd_driver *swd_trace_wrap(const struct swd_driver *swd)
+{
+	if (!swd || !swd_trace_file)
+		return swd;
+
+	swd_trace_driver = swd;
+	swd_trace_ops.trace = swd->trace ? swd_trace_trace : NULL;
+
+	return &swd_trace_ops;
+}
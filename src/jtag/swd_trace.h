@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_JTAG_SWD_TRACE_H
+#define OPENOCD_JTAG_SWD_TRACE_H
+
+#include <jtag/swd.h>
+
+/*
+ * SWD trace file format
+ *
+ * The file starts with the 8 byte SWD_TRACE_MAGIC, followed by one record
+ * per swd_driver call. Each record starts with its type byte, all following
+ * fields are little endian:
+ *
+ * SWD_TRACE_SWITCH_SEQ	u8 seq, u32 result
+ * SWD_TRACE_READ	u8 cmd, u32 ap_delay_hint
+ * SWD_TRACE_WRITE	u8 cmd, u32 value, u32 ap_delay_hint
+ * SWD_TRACE_RUN	u32 result, u32 elapsed_us, u32 count,
+ *			count * u32 value of the reads queued since the last run
+ */
+#define SWD_TRACE_MAGIC			"OCDSWDT1"
+#define SWD_TRACE_MAGIC_SIZE	8
+
+enum swd_trace_record {
+	SWD_TRACE_SWITCH_SEQ = 'S',
+	SWD_TRACE_READ = 'R',
+	SWD_TRACE_WRITE = 'W',
+	SWD_TRACE_RUN = 'X',
+};
+
+/**
+ * Record all SWD transactions of the session into @a filename.
+ * Must be called before the DAPs are initialized.
+ */
+int swd_trace_record_start(const char *filename);
+
+/** Close the trace file, if any. */
+void swd_trace_record_stop(void);
+
+/**
+ * Returns a driver recording the calls to @a swd and their results when
+ * recording has been requested, @a swd itself otherwise.
+ */
+const struct swd_driver *swd_trace_wrap(const struct swd_driver *swd);
+
+#endif /* OPENOCD_JTAG_SWD_TRACE_H */
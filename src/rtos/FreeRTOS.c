@@ -152,7 +152,7 @@ static int freertos_update_threads(struct rtos *rtos)
 	}
 
 	uint32_t thread_list_size = 0;
-	retval = target_read_u32(rtos->target,
+	retval = rtos_cache_read_u32(rtos,
 			rtos->symbols[FREERTOS_VAL_UX_CURRENT_NUMBER_OF_TASKS].address,
 			&thread_list_size);
 	LOG_DEBUG("FreeRTOS: Read uxCurrentNumberOfTasks at 0x%" PRIx64 ", value %" PRIu32,
@@ -164,12 +164,12 @@ static int freertos_update_threads(struct rtos *rtos)
 		return retval;
 	}
 
-	/* wipe out previous thread details if any */
-	rtos_free_threadlist(rtos);
+	/* set aside previous thread details if any, names are reused below */
+	rtos_stash_threadlist(rtos);
 
 	/* read the current thread */
 	uint32_t pointer_casts_are_bad;
-	retval = target_read_u32(rtos->target,
+	retval = rtos_cache_read_u32(rtos,
 			rtos->symbols[FREERTOS_VAL_PX_CURRENT_TCB].address,
 			&pointer_casts_are_bad);
 	if (retval != ERROR_OK) {
@@ -183,7 +183,7 @@ static int freertos_update_threads(struct rtos *rtos)
 
 	/* read scheduler running */
 	uint32_t scheduler_running;
-	retval = target_read_u32(rtos->target,
+	retval = rtos_cache_read_u32(rtos,
 			rtos->symbols[FREERTOS_VAL_X_SCHEDULER_RUNNING].address,
 			&scheduler_running);
 	if (retval != ERROR_OK) {
@@ -234,7 +234,7 @@ static int freertos_update_threads(struct rtos *rtos)
 		return ERROR_FAIL;
 	}
 	uint32_t top_used_priority = 0;
-	retval = target_read_u32(rtos->target,
+	retval = rtos_cache_read_u32(rtos,
 			rtos->symbols[FREERTOS_VAL_UX_TOP_USED_PRIORITY].address,
 			&top_used_priority);
 	if (retval != ERROR_OK)
@@ -273,13 +273,17 @@ static int freertos_update_threads(struct rtos *rtos)
 	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_SUSPENDED_TASK_LIST].address;
 	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_TASKS_WAITING_TERMINATION].address;
 
+	/* Fetch all the ready list heads in one go */
+	rtos_cache_prefetch(rtos, rtos->symbols[FREERTOS_VAL_PX_READY_TASKS_LISTS].address,
+			config_max_priorities * param->list_width);
+
 	for (unsigned int i = 0; i < num_lists; i++) {
 		if (list_of_lists[i] == 0)
 			continue;
 
 		/* Read the number of threads in this list */
 		uint32_t list_thread_count = 0;
-		retval = target_read_u32(rtos->target,
+		retval = rtos_cache_read_u32(rtos,
 				list_of_lists[i],
 				&list_thread_count);
 		if (retval != ERROR_OK) {
@@ -296,7 +300,7 @@ static int freertos_update_threads(struct rtos *rtos)
 		/* Read the location of first list item */
 		uint32_t prev_list_elem_ptr = -1;
 		uint32_t list_elem_ptr = 0;
-		retval = target_read_u32(rtos->target,
+		retval = rtos_cache_read_u32(rtos,
 				list_of_lists[i] + param->list_next_offset,
 				&list_elem_ptr);
 		if (retval != ERROR_OK) {
@@ -311,7 +315,7 @@ static int freertos_update_threads(struct rtos *rtos)
 				(list_elem_ptr != prev_list_elem_ptr) &&
 				(tasks_found < thread_list_size)) {
 			/* Get the location of the thread structure. */
-			retval = target_read_u32(rtos->target,
+			retval = rtos_cache_read_u32(rtos,
 					list_elem_ptr + param->list_elem_content_offset,
 					&pointer_casts_are_bad);
 			if (retval != ERROR_OK) {
@@ -324,32 +328,45 @@ static int freertos_update_threads(struct rtos *rtos)
 										list_elem_ptr + param->list_elem_content_offset,
 										rtos->thread_details[tasks_found].threadid);
 
-			/* get thread name */
-
-			#define FREERTOS_THREAD_NAME_STR_SIZE (200)
-			char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
-
-			/* Read the thread name */
-			retval = target_read_buffer(rtos->target,
-					rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
-					FREERTOS_THREAD_NAME_STR_SIZE,
-					(uint8_t *)&tmp_str);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
+			/* get thread name; it is fixed when the task is created,
+			 * so threads known from the previous update keep theirs as
+			 * long as the TCB still holds it: a new task may reuse the
+			 * TCB of a deleted one */
+			const char *stashed_name = rtos_stashed_thread_name(rtos,
+					rtos->thread_details[tasks_found].threadid);
+			if (stashed_name) {
+				const char *expected = strcmp(stashed_name, "No Name") ? stashed_name : "";
+				if (!rtos_cache_compare(rtos,
+						rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
+						strlen(expected) + 1, expected))
+					stashed_name = NULL;
+			}
+			if (stashed_name) {
+				rtos->thread_details[tasks_found].thread_name_str = strdup(stashed_name);
+			} else {
+				#define FREERTOS_THREAD_NAME_STR_SIZE (200)
+				char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
+
+				/* Read the thread name */
+				retval = rtos_cache_read(rtos,
+						rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
+						FREERTOS_THREAD_NAME_STR_SIZE,
+						(uint8_t *)&tmp_str);
+				if (retval != ERROR_OK) {
+					LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
+					free(list_of_lists);
+					return retval;
+				}
+				tmp_str[FREERTOS_THREAD_NAME_STR_SIZE-1] = '\x00';
+				LOG_DEBUG("FreeRTOS: Read Thread Name at 0x%" PRIx64 ", value '%s'",
+											rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
+											tmp_str);
+
+				if (tmp_str[0] == '\x00')
+					strcpy(tmp_str, "No Name");
+
+				rtos->thread_details[tasks_found].thread_name_str = strdup(tmp_str);
 			}
-			tmp_str[FREERTOS_THREAD_NAME_STR_SIZE-1] = '\x00';
-			LOG_DEBUG("FreeRTOS: Read Thread Name at 0x%" PRIx64 ", value '%s'",
-										rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
-										tmp_str);
-
-			if (tmp_str[0] == '\x00')
-				strcpy(tmp_str, "No Name");
-
-			rtos->thread_details[tasks_found].thread_name_str =
-				malloc(strlen(tmp_str)+1);
-			strcpy(rtos->thread_details[tasks_found].thread_name_str, tmp_str);
 			rtos->thread_details[tasks_found].exists = true;
 
 			if (rtos->thread_details[tasks_found].threadid == rtos->current_thread) {
@@ -367,7 +384,7 @@ static int freertos_update_threads(struct rtos *rtos)
 
 			prev_list_elem_ptr = list_elem_ptr;
 			list_elem_ptr = 0;
-			retval = target_read_u32(rtos->target,
+			retval = rtos_cache_read_u32(rtos,
 					prev_list_elem_ptr + param->list_elem_next_offset,
 					&list_elem_ptr);
 			if (retval != ERROR_OK) {
@@ -405,7 +422,7 @@ static int freertos_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 
 	/* Read the stack pointer */
 	uint32_t pointer_casts_are_bad;
-	retval = target_read_u32(rtos->target,
+	retval = rtos_cache_read_u32(rtos,
 			thread_id + param->thread_stack_offset,
 			&pointer_casts_are_bad);
 	if (retval != ERROR_OK) {
@@ -443,7 +460,7 @@ static int freertos_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 	if (cm4_fpu_enabled == 1) {
 		/* Read the LR to decide between stacking with or without FPU */
 		uint32_t lr_svc = 0;
-		retval = target_read_u32(rtos->target,
+		retval = rtos_cache_read_u32(rtos,
 				stack_ptr + 0x20,
 				&lr_svc);
 		if (retval != ERROR_OK) {
@@ -34,7 +34,25 @@ static const struct rtos_type *rtos_types[] = {
 	NULL
 };
 
+/* Granularity of the target memory snapshot, see rtos_cache_read() */
+#define RTOS_CACHE_LINE_SIZE	64
+#define RTOS_CACHE_LINES		512
+
+struct rtos_cache_line {
+	target_addr_t address;
+	bool valid;
+	uint8_t data[RTOS_CACHE_LINE_SIZE];
+};
+
+/* Saved registers of a thread, kept as long as the snapshot is valid */
+struct rtos_thread_regs {
+	threadid_t threadid;
+	struct rtos_reg *reg_list;
+	int num_regs;
+};
+
 static int rtos_try_next(struct target *target);
+static void rtos_free_stashed_threadlist(struct rtos *rtos);
 
 int rtos_smp_init(struct target *target)
 {
@@ -52,6 +70,30 @@ static int rtos_target_for_threadid(struct connection *connection, int64_t threa
 	return ERROR_OK;
 }
 
+static int rtos_event_callback(struct target *target, enum target_event event, void *priv)
+{
+	struct rtos *os = priv;
+
+	if (os->target != target)
+		return ERROR_OK;
+
+	/* whatever the thread list was built from may change from now on */
+	switch (event) {
+	case TARGET_EVENT_RESET_ASSERT:
+		/* the threads of the next run may reuse the same TCBs */
+		rtos_free_stashed_threadlist(os);
+		/* fall through */
+	case TARGET_EVENT_RESUMED:
+	case TARGET_EVENT_DEBUG_RESUMED:
+		rtos_cache_invalidate(os);
+		break;
+	default:
+		break;
+	}
+
+	return ERROR_OK;
+}
+
 static int os_alloc(struct target *target, const struct rtos_type *ostype)
 {
 	struct rtos *os = target->rtos = calloc(1, sizeof(struct rtos));
@@ -69,6 +111,8 @@ static int os_alloc(struct target *target, const struct rtos_type *ostype)
 	os->gdb_thread_packet = rtos_thread_packet;
 	os->gdb_target_for_threadid = rtos_target_for_threadid;
 
+	target_register_event_callback(rtos_event_callback, os);
+
 	return JIM_OK;
 }
 
@@ -77,8 +121,14 @@ static void os_free(struct target *target)
 	if (!target->rtos)
 		return;
 
+	target_unregister_event_callback(rtos_event_callback, target->rtos);
+
 	free(target->rtos->symbols);
 	rtos_free_threadlist(target->rtos);
+	/* stashing the now empty list frees the previous one */
+	rtos_stash_threadlist(target->rtos);
+	rtos_cache_invalidate(target->rtos);
+	free(target->rtos->cache);
 	free(target->rtos);
 	target->rtos = NULL;
 }
@@ -393,7 +443,7 @@ int rtos_thread_packet(struct connection *connection, char const *packet, int pa
 				target->rtos_auto_detect = false;
 				target->rtos->type->create(target);
 			}
-			target->rtos->type->update_threads(target->rtos);
+			rtos_update_threads(target);
 		}
 		return ERROR_OK;
 	} else if (strncmp(packet, "qfThreadInfo", 12) == 0) {
@@ -499,6 +549,72 @@ static int rtos_put_gdb_reg_list(struct connection *connection,
 	return ERROR_OK;
 }
 
+/* Drop the snapshot if target memory may have changed since it was taken */
+static void rtos_cache_check(struct rtos *rtos)
+{
+	if (rtos->cache_generation != rtos->target->memory_generation) {
+		rtos_cache_invalidate(rtos);
+		rtos->cache_generation = rtos->target->memory_generation;
+	}
+}
+
+static struct rtos_thread_regs *rtos_thread_regs_lookup(struct rtos *rtos, threadid_t threadid)
+{
+	rtos_cache_check(rtos);
+
+	for (int i = 0; i < rtos->thread_regs_count; i++) {
+		if (rtos->thread_regs[i].threadid == threadid)
+			return &rtos->thread_regs[i];
+	}
+
+	return NULL;
+}
+
+static void rtos_thread_regs_free(struct rtos *rtos)
+{
+	for (int i = 0; i < rtos->thread_regs_count; i++)
+		free(rtos->thread_regs[i].reg_list);
+	free(rtos->thread_regs);
+	rtos->thread_regs = NULL;
+	rtos->thread_regs_count = 0;
+}
+
+/**
+ * Get the saved registers of a thread.  They are unwound from the thread's
+ * stack only the first time they are needed after a halt; GDB asks for the
+ * same threads over and over while it builds backtraces.  The returned
+ * list is owned by the RTOS layer and stays valid until the target resumes.
+ */
+static int rtos_get_thread_reg_list(struct rtos *rtos, threadid_t threadid,
+		struct rtos_reg **reg_list, int *num_regs)
+{
+	struct rtos_thread_regs *regs = rtos_thread_regs_lookup(rtos, threadid);
+
+	if (!regs) {
+		struct rtos_reg *list;
+		int count;
+		int retval = rtos->type->get_thread_reg_list(rtos, threadid, &list, &count);
+		if (retval != ERROR_OK)
+			return retval;
+
+		regs = realloc(rtos->thread_regs,
+				(rtos->thread_regs_count + 1) * sizeof(*rtos->thread_regs));
+		if (!regs) {
+			free(list);
+			return ERROR_FAIL;
+		}
+		rtos->thread_regs = regs;
+		regs = &rtos->thread_regs[rtos->thread_regs_count++];
+		regs->threadid = threadid;
+		regs->reg_list = list;
+		regs->num_regs = count;
+	}
+
+	*reg_list = regs->reg_list;
+	*num_regs = regs->num_regs;
+	return ERROR_OK;
+}
+
 /** Look through all registers to find this register. */
 int rtos_get_gdb_reg(struct connection *connection, int reg_num)
 {
@@ -518,20 +634,24 @@ int rtos_get_gdb_reg(struct connection *connection, int reg_num)
 										target->rtos->current_thread);
 
 		int retval;
-		if (target->rtos->type->get_thread_reg) {
-			reg_list = calloc(1, sizeof(*reg_list));
-			num_regs = 1;
+		struct rtos_thread_regs *regs = rtos_thread_regs_lookup(target->rtos, current_threadid);
+		if (regs) {
+			reg_list = regs->reg_list;
+			num_regs = regs->num_regs;
+		} else if (target->rtos->type->get_thread_reg) {
+			/* fetch just the one register */
+			struct rtos_reg reg;
 			retval = target->rtos->type->get_thread_reg(target->rtos,
-					current_threadid, reg_num, &reg_list[0]);
+					current_threadid, reg_num, &reg);
 			if (retval != ERROR_OK) {
 				LOG_ERROR("RTOS: failed to get register %d", reg_num);
 				return retval;
 			}
+			rtos_put_gdb_reg_list(connection, &reg, 1);
+			return ERROR_OK;
 		} else {
-			retval = target->rtos->type->get_thread_reg_list(target->rtos,
-					current_threadid,
-					&reg_list,
-					&num_regs);
+			retval = rtos_get_thread_reg_list(target->rtos, current_threadid,
+					&reg_list, &num_regs);
 			if (retval != ERROR_OK) {
 				LOG_ERROR("RTOS: failed to get register list");
 				return retval;
@@ -541,12 +661,9 @@ int rtos_get_gdb_reg(struct connection *connection, int reg_num)
 		for (int i = 0; i < num_regs; ++i) {
 			if (reg_list[i].number == (uint32_t)reg_num) {
 				rtos_put_gdb_reg_list(connection, reg_list + i, 1);
-				free(reg_list);
 				return ERROR_OK;
 			}
 		}
-
-		free(reg_list);
 	}
 	return ERROR_FAIL;
 }
@@ -568,17 +685,14 @@ int rtos_get_gdb_reg_list(struct connection *connection)
 										current_threadid,
 										target->rtos->current_thread);
 
-		int retval = target->rtos->type->get_thread_reg_list(target->rtos,
-				current_threadid,
-				&reg_list,
-				&num_regs);
+		int retval = rtos_get_thread_reg_list(target->rtos, current_threadid,
+				&reg_list, &num_regs);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("RTOS: failed to get register list");
 			return retval;
 		}
 
 		rtos_put_gdb_reg_list(connection, reg_list, num_regs);
-		free(reg_list);
 
 		return ERROR_OK;
 	}
@@ -594,6 +708,7 @@ int rtos_set_reg(struct connection *connection, int reg_num,
 			(target->rtos->type->set_reg) &&
 			(current_threadid != -1) &&
 			(current_threadid != 0)) {
+		rtos_cache_invalidate(target->rtos);
 		return target->rtos->type->set_reg(target->rtos, reg_num, reg_value);
 	}
 	return ERROR_FAIL;
@@ -619,6 +734,8 @@ int rtos_generic_stack_read(struct target *target,
 		address -= stacking->stack_registers_size;
 	if (stacking->read_stack)
 		retval = stacking->read_stack(target, address, stacking, stack_data);
+	else if (target->rtos)
+		retval = rtos_cache_read(target->rtos, address, stacking->stack_registers_size, stack_data);
 	else
 		retval = target_read_buffer(target, address, stacking->stack_registers_size, stack_data);
 	if (retval != ERROR_OK) {
@@ -687,22 +804,27 @@ static int rtos_try_next(struct target *target)
 
 int rtos_update_threads(struct target *target)
 {
-	if ((target->rtos) && (target->rtos->type))
+	if ((target->rtos) && (target->rtos->type)) {
+		/* start from a fresh memory snapshot */
+		rtos_cache_invalidate(target->rtos);
 		target->rtos->type->update_threads(target->rtos);
+	}
 	return ERROR_OK;
 }
 
+static void rtos_free_thread_details(struct thread_detail *details, int count)
+{
+	for (int j = 0; j < count; j++) {
+		free(details[j].thread_name_str);
+		free(details[j].extra_info_str);
+	}
+	free(details);
+}
+
 void rtos_free_threadlist(struct rtos *rtos)
 {
 	if (rtos->thread_details) {
-		int j;
-
-		for (j = 0; j < rtos->thread_count; j++) {
-			struct thread_detail *current_thread = &rtos->thread_details[j];
-			free(current_thread->thread_name_str);
-			free(current_thread->extra_info_str);
-		}
-		free(rtos->thread_details);
+		rtos_free_thread_details(rtos->thread_details, rtos->thread_count);
 		rtos->thread_details = NULL;
 		rtos->thread_count = 0;
 		rtos->current_threadid = -1;
@@ -710,6 +832,205 @@ void rtos_free_threadlist(struct rtos *rtos)
 	}
 }
 
+static void rtos_free_stashed_threadlist(struct rtos *rtos)
+{
+	rtos_free_thread_details(rtos->stashed_thread_details, rtos->stashed_thread_count);
+	rtos->stashed_thread_details = NULL;
+	rtos->stashed_thread_count = 0;
+}
+
+/**
+ * Like rtos_free_threadlist(), but keeps the thread list around until the
+ * next call, so that an update can reuse what it already knows about the
+ * threads that still exist through rtos_stashed_thread_name().
+ */
+void rtos_stash_threadlist(struct rtos *rtos)
+{
+	rtos_free_thread_details(rtos->stashed_thread_details, rtos->stashed_thread_count);
+
+	rtos->stashed_thread_details = rtos->thread_details;
+	rtos->stashed_thread_count = rtos->thread_count;
+	rtos->stashed_memory_writes = rtos->target->memory_writes;
+
+	rtos->thread_details = NULL;
+	rtos->thread_count = 0;
+	rtos->current_threadid = -1;
+	rtos->current_thread = 0;
+}
+
+/**
+ * Look up the name a thread had in the previous update.  The TCB of a
+ * deleted thread can be reused by a new one, so callers must check that
+ * the name is still in target memory, see rtos_cache_compare().  The list
+ * is dropped once target memory was written, e.g. by loading a new image.
+ * @returns the name, or NULL if the thread was not known.
+ */
+const char *rtos_stashed_thread_name(struct rtos *rtos, threadid_t threadid)
+{
+	if (rtos->stashed_memory_writes != rtos->target->memory_writes)
+		rtos_free_stashed_threadlist(rtos);
+
+	for (int j = 0; j < rtos->stashed_thread_count; j++) {
+		if (rtos->stashed_thread_details[j].threadid == threadid)
+			return rtos->stashed_thread_details[j].thread_name_str;
+	}
+
+	return NULL;
+}
+
+/**
+ * Drop the memory snapshot and the thread registers unwound from it; done
+ * before each thread list update, whenever the target resumes or runs an
+ * algorithm, when a thread register is written and, see rtos_cache_check(),
+ * when target memory may have changed otherwise.
+ */
+void rtos_cache_invalidate(struct rtos *rtos)
+{
+	rtos_thread_regs_free(rtos);
+
+	if (!rtos->cache)
+		return;
+
+	for (unsigned int i = 0; i < RTOS_CACHE_LINES; i++)
+		rtos->cache[i].valid = false;
+}
+
+static struct rtos_cache_line *rtos_cache_lookup(struct rtos *rtos, target_addr_t address)
+{
+	struct rtos_cache_line *line =
+		&rtos->cache[(address / RTOS_CACHE_LINE_SIZE) % RTOS_CACHE_LINES];
+
+	if (line->valid && line->address == address)
+		return line;
+
+	return NULL;
+}
+
+static int rtos_cache_fill(struct rtos *rtos, target_addr_t address, uint32_t size)
+{
+	uint8_t *data = malloc(size);
+	if (!data)
+		return ERROR_FAIL;
+
+	int retval = target_read_buffer(rtos->target, address, size, data);
+	if (retval == ERROR_OK) {
+		for (uint32_t offset = 0; offset < size; offset += RTOS_CACHE_LINE_SIZE) {
+			struct rtos_cache_line *line =
+				&rtos->cache[((address + offset) / RTOS_CACHE_LINE_SIZE) % RTOS_CACHE_LINES];
+			line->address = address + offset;
+			line->valid = true;
+			memcpy(line->data, data + offset, RTOS_CACHE_LINE_SIZE);
+		}
+	}
+
+	free(data);
+	return retval;
+}
+
+/* Make sure all lines covering the range are in the snapshot */
+static int rtos_cache_fetch(struct rtos *rtos, target_addr_t address, uint32_t size)
+{
+	if (size > RTOS_CACHE_LINE_SIZE * RTOS_CACHE_LINES / 2)
+		return ERROR_FAIL;
+
+	if (!rtos->cache) {
+		rtos->cache = calloc(RTOS_CACHE_LINES, sizeof(struct rtos_cache_line));
+		if (!rtos->cache)
+			return ERROR_FAIL;
+	}
+
+	rtos_cache_check(rtos);
+
+	target_addr_t end = address + size;
+	target_addr_t line = address & ~(target_addr_t)(RTOS_CACHE_LINE_SIZE - 1);
+
+	while (line < end) {
+		if (rtos_cache_lookup(rtos, line)) {
+			line += RTOS_CACHE_LINE_SIZE;
+			continue;
+		}
+
+		target_addr_t miss_end = line + RTOS_CACHE_LINE_SIZE;
+		while (miss_end < end && !rtos_cache_lookup(rtos, miss_end))
+			miss_end += RTOS_CACHE_LINE_SIZE;
+
+		int retval = rtos_cache_fill(rtos, line, miss_end - line);
+		if (retval != ERROR_OK)
+			return retval;
+		line = miss_end;
+	}
+
+	return ERROR_OK;
+}
+
+/**
+ * Read target memory through a snapshot taken while the target is halted.
+ * Memory is fetched in aligned lines, with consecutive missing lines merged
+ * into one target read, so that walking linked lists of thread control
+ * blocks field by field costs one transfer per block instead of one per
+ * field.  If a line cannot be read (e.g. it extends past the end of RAM)
+ * the requested range is read directly instead.
+ */
+int rtos_cache_read(struct rtos *rtos, target_addr_t address, uint32_t size,
+		uint8_t *buffer)
+{
+	if (rtos_cache_fetch(rtos, address, size) != ERROR_OK) {
+		LOG_DEBUG("RTOS: uncached read at " TARGET_ADDR_FMT, address);
+		return target_read_buffer(rtos->target, address, size, buffer);
+	}
+
+	target_addr_t end = address + size;
+	while (address < end) {
+		target_addr_t line = address & ~(target_addr_t)(RTOS_CACHE_LINE_SIZE - 1);
+		struct rtos_cache_line *cached = rtos_cache_lookup(rtos, line);
+		uint32_t offset = address - line;
+		uint32_t count = MIN(RTOS_CACHE_LINE_SIZE - offset, end - address);
+
+		memcpy(buffer, cached->data + offset, count);
+		buffer += count;
+		address += count;
+	}
+
+	return ERROR_OK;
+}
+
+/**
+ * Pull a range into the snapshot with a single target read, e.g. an array
+ * of list heads that is about to be walked entry by entry.  Failures are
+ * not fatal, later rtos_cache_read() calls fall back to direct reads.
+ */
+void rtos_cache_prefetch(struct rtos *rtos, target_addr_t address, uint32_t size)
+{
+	if (rtos_cache_fetch(rtos, address, size) != ERROR_OK)
+		LOG_DEBUG("RTOS: prefetch at " TARGET_ADDR_FMT " failed", address);
+}
+
+/**
+ * Check that target memory at @a address holds the @a size bytes of
+ * @a expected, reading through the snapshot.
+ */
+bool rtos_cache_compare(struct rtos *rtos, target_addr_t address, uint32_t size,
+		const void *expected)
+{
+	uint8_t *buffer = malloc(size);
+	bool same = buffer && rtos_cache_read(rtos, address, size, buffer) == ERROR_OK
+		&& !memcmp(buffer, expected, size);
+
+	free(buffer);
+	return same;
+}
+
+int rtos_cache_read_u32(struct rtos *rtos, target_addr_t address, uint32_t *value)
+{
+	uint8_t buf[4];
+
+	int retval = rtos_cache_read(rtos, address, sizeof(buf), buf);
+	if (retval == ERROR_OK)
+		*value = target_buffer_get_u32(rtos->target, buf);
+
+	return retval;
+}
+
 int rtos_read_buffer(struct target *target, target_addr_t address,
 		uint32_t size, uint8_t *buffer)
 {
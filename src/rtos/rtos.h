@@ -16,6 +16,8 @@ typedef int64_t threadid_t;
 typedef int64_t symbol_address_t;
 
 struct reg;
+struct rtos_cache_line;
+struct rtos_thread_regs;
 
 /**
  * Table should be terminated by an element with NULL in symbol_name
@@ -48,6 +50,18 @@ struct rtos {
 	int (*gdb_thread_packet)(struct connection *connection, char const *packet, int packet_size);
 	int (*gdb_target_for_threadid)(struct connection *connection, int64_t thread_id, struct target **p_target);
 	void *rtos_specific_params;
+	/* Snapshot of target memory while halted, see rtos_cache_read(). */
+	struct rtos_cache_line *cache;
+	/* target->memory_generation the snapshot was taken at */
+	unsigned int cache_generation;
+	/* Register lists of threads read from the snapshot. */
+	struct rtos_thread_regs *thread_regs;
+	int thread_regs_count;
+	/* Thread list of the previous update, see rtos_stash_threadlist(). */
+	struct thread_detail *stashed_thread_details;
+	int stashed_thread_count;
+	/* target->memory_writes when the thread list was stashed */
+	unsigned int stashed_memory_writes;
 };
 
 struct rtos_reg {
@@ -128,6 +142,15 @@ int rtos_get_gdb_reg(struct connection *connection, int reg_num);
 int rtos_get_gdb_reg_list(struct connection *connection);
 int rtos_update_threads(struct target *target);
 void rtos_free_threadlist(struct rtos *rtos);
+void rtos_stash_threadlist(struct rtos *rtos);
+const char *rtos_stashed_thread_name(struct rtos *rtos, threadid_t threadid);
+void rtos_cache_invalidate(struct rtos *rtos);
+int rtos_cache_read(struct rtos *rtos, target_addr_t address, uint32_t size,
+		uint8_t *buffer);
+int rtos_cache_read_u32(struct rtos *rtos, target_addr_t address, uint32_t *value);
+bool rtos_cache_compare(struct rtos *rtos, target_addr_t address, uint32_t size,
+		const void *expected);
+void rtos_cache_prefetch(struct rtos *rtos, target_addr_t address, uint32_t size);
 int rtos_smp_init(struct target *target);
 /*  function for handling symbol access */
 int rtos_qsymbol(struct connection *connection, char const *packet, int packet_size);
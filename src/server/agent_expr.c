@@ -0,0 +1,438 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * Evaluation of GDB agent expressions.
+ *
+ * GDB compiles some expressions, like the conditions of breakpoints, into
+ * a simple stack machine bytecode, which the stub evaluates by itself
+ * instead of stopping and asking GDB to do it.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "agent_expr.h"
+#include <helper/binarybuffer.h>
+#include <helper/log.h>
+#include <target/register.h>
+#include <target/target.h>
+
+#define AGENT_EXPR_STACK_SIZE	100
+
+/* bound the run time of expressions looping forever */
+#define AGENT_EXPR_MAX_STEPS	100000
+
+enum agent_op {
+	AGENT_OP_ADD = 0x02,
+	AGENT_OP_SUB = 0x03,
+	AGENT_OP_MUL = 0x04,
+	AGENT_OP_DIV_SIGNED = 0x05,
+	AGENT_OP_DIV_UNSIGNED = 0x06,
+	AGENT_OP_REM_SIGNED = 0x07,
+	AGENT_OP_REM_UNSIGNED = 0x08,
+	AGENT_OP_LSH = 0x09,
+	AGENT_OP_RSH_SIGNED = 0x0a,
+	AGENT_OP_RSH_UNSIGNED = 0x0b,
+	AGENT_OP_TRACE = 0x0c,
+	AGENT_OP_TRACE_QUICK = 0x0d,
+	AGENT_OP_LOG_NOT = 0x0e,
+	AGENT_OP_BIT_AND = 0x0f,
+	AGENT_OP_BIT_OR = 0x10,
+	AGENT_OP_BIT_XOR = 0x11,
+	AGENT_OP_BIT_NOT = 0x12,
+	AGENT_OP_EQUAL = 0x13,
+	AGENT_OP_LESS_SIGNED = 0x14,
+	AGENT_OP_LESS_UNSIGNED = 0x15,
+	AGENT_OP_EXT = 0x16,
+	AGENT_OP_REF8 = 0x17,
+	AGENT_OP_REF16 = 0x18,
+	AGENT_OP_REF32 = 0x19,
+	AGENT_OP_REF64 = 0x1a,
+	AGENT_OP_IF_GOTO = 0x20,
+	AGENT_OP_GOTO = 0x21,
+	AGENT_OP_CONST8 = 0x22,
+	AGENT_OP_CONST16 = 0x23,
+	AGENT_OP_CONST32 = 0x24,
+	AGENT_OP_CONST64 = 0x25,
+	AGENT_OP_REG = 0x26,
+	AGENT_OP_END = 0x27,
+	AGENT_OP_DUP = 0x28,
+	AGENT_OP_POP = 0x29,
+	AGENT_OP_ZERO_EXT = 0x2a,
+	AGENT_OP_SWAP = 0x2b,
+	AGENT_OP_TRACENZ = 0x2f,
+	AGENT_OP_TRACE16 = 0x30,
+	AGENT_OP_PICK = 0x32,
+	AGENT_OP_ROT = 0x33,
+};
+
+int agent_expr_parse(const char *packet, const char **end, struct agent_expr **expr)
+{
+	char *separator;
+	unsigned long length = strtoul(packet, &separator, 16);
+
+	if (*separator != ',' || length == 0 || strlen(separator + 1) < 2 * length)
+		return ERROR_FAIL;
+
+	struct agent_expr *e = malloc(sizeof(*e));
+	uint8_t *bytes = malloc(length);
+	if (!e || !bytes) {
+		free(e);
+		free(bytes);
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	if (unhexify(bytes, separator + 1, length) != length) {
+		free(e);
+		free(bytes);
+		return ERROR_FAIL;
+	}
+
+	e->length = length;
+	e->bytes = bytes;
+	*expr = e;
+	*end = separator + 1 + 2 * length;
+
+	return ERROR_OK;
+}
+
+void agent_expr_free(struct agent_expr *expr)
+{
+	if (!expr)
+		return;
+
+	free(expr->bytes);
+	free(expr);
+}
+
+static int agent_expr_reg(struct target *target, unsigned int regnum, uint64_t *value)
+{
+	struct reg **reg_list;
+	int reg_list_size;
+
+	int retval = target_get_gdb_reg_list_noread(target, &reg_list, &reg_list_size,
+			REG_CLASS_ALL);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (regnum >= (unsigned int)reg_list_size || !reg_list[regnum]
+			|| !reg_list[regnum]->exist) {
+		LOG_DEBUG("agent expression reads unknown register %u", regnum);
+		free(reg_list);
+		return ERROR_FAIL;
+	}
+
+	struct reg *reg = reg_list[regnum];
+	free(reg_list);
+
+	if (!reg->valid) {
+		retval = reg->type->get(reg);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	*value = buf_get_u64(reg->value, 0, MIN(reg->size, 64));
+	return ERROR_OK;
+}
+
+static int agent_expr_ref(struct target *target, target_addr_t address,
+		unsigned int size, uint64_t *value)
+{
+	int retval;
+
+	switch (size) {
+	case 1: {
+		uint8_t v;
+		retval = target_read_u8(target, address, &v);
+		*value = v;
+		break;
+	}
+	case 2: {
+		uint16_t v;
+		retval = target_read_u16(target, address, &v);
+		*value = v;
+		break;
+	}
+	case 4: {
+		uint32_t v;
+		retval = target_read_u32(target, address, &v);
+		*value = v;
+		break;
+	}
+	default:
+		retval = target_read_u64(target, address, value);
+		break;
+	}
+
+	return retval;
+}
+
+/* Operands are big endian, and must be within the expression */
+static bool agent_expr_operand(const struct agent_expr *expr, unsigned int *pc,
+		unsigned int size, uint64_t *value)
+{
+	if (*pc + size > expr->length)
+		return false;
+
+	*value = 0;
+	for (unsigned int i = 0; i < size; i++)
+		*value = (*value << 8) | expr->bytes[(*pc)++];
+
+	return true;
+}
+
+int agent_expr_eval(struct target *target, const struct agent_expr *expr,
+		agent_expr_trace_fn trace, void *priv, uint64_t *result)
+{
+	uint64_t stack[AGENT_EXPR_STACK_SIZE];
+	unsigned int sp = 0;
+	unsigned int pc = 0;
+	int retval;
+
+#define OPERAND(n, v) do { \
+		if (!agent_expr_operand(expr, &pc, (n), &(v))) \
+			goto truncated; \
+	} while (0)
+#define NEED(n) do { \
+		if (sp < (n)) \
+			goto underflow; \
+	} while (0)
+#define PUSH(v) do { \
+		uint64_t pushed = (v); \
+		if (sp == AGENT_EXPR_STACK_SIZE) \
+			goto overflow; \
+		stack[sp++] = pushed; \
+	} while (0)
+#define TOP (stack[sp - 1])
+#define NEXT (stack[sp - 2])
+
+	for (unsigned int steps = 0; steps < AGENT_EXPR_MAX_STEPS; steps++) {
+		if (pc >= expr->length)
+			goto truncated;
+
+		uint8_t op = expr->bytes[pc++];
+		uint64_t a, b;
+
+		switch (op) {
+		case AGENT_OP_ADD:
+			NEED(2);
+			NEXT += TOP;
+			sp--;
+			break;
+		case AGENT_OP_SUB:
+			NEED(2);
+			NEXT -= TOP;
+			sp--;
+			break;
+		case AGENT_OP_MUL:
+			NEED(2);
+			NEXT *= TOP;
+			sp--;
+			break;
+		case AGENT_OP_DIV_SIGNED:
+		case AGENT_OP_DIV_UNSIGNED:
+		case AGENT_OP_REM_SIGNED:
+		case AGENT_OP_REM_UNSIGNED:
+			NEED(2);
+			b = stack[--sp];
+			a = TOP;
+			if (b == 0) {
+				LOG_DEBUG("agent expression divides by zero");
+				return ERROR_FAIL;
+			}
+			if (op == AGENT_OP_DIV_SIGNED)
+				TOP = (b == UINT64_MAX) ? -a : (uint64_t)((int64_t)a / (int64_t)b);
+			else if (op == AGENT_OP_DIV_UNSIGNED)
+				TOP = a / b;
+			else if (op == AGENT_OP_REM_SIGNED)
+				TOP = (b == UINT64_MAX) ? 0 : (uint64_t)((int64_t)a % (int64_t)b);
+			else
+				TOP = a % b;
+			break;
+		case AGENT_OP_LSH:
+			NEED(2);
+			b = stack[--sp];
+			TOP = (b < 64) ? TOP << b : 0;
+			break;
+		case AGENT_OP_RSH_SIGNED:
+			NEED(2);
+			b = stack[--sp];
+			TOP = (int64_t)TOP >> MIN(b, 63);
+			break;
+		case AGENT_OP_RSH_UNSIGNED:
+			NEED(2);
+			b = stack[--sp];
+			TOP = (b < 64) ? TOP >> b : 0;
+			break;
+		case AGENT_OP_TRACE:
+		case AGENT_OP_TRACENZ:
+			/* addr size => */
+			NEED(2);
+			sp -= 2;
+			if (trace) {
+				retval = trace(priv, stack[sp], stack[sp + 1], op == AGENT_OP_TRACENZ);
+				if (retval != ERROR_OK)
+					return retval;
+			}
+			break;
+		case AGENT_OP_TRACE_QUICK:
+		case AGENT_OP_TRACE16:
+			/* addr => addr */
+			NEED(1);
+			OPERAND(op == AGENT_OP_TRACE16 ? 2 : 1, a);
+			if (trace) {
+				retval = trace(priv, TOP, a, false);
+				if (retval != ERROR_OK)
+					return retval;
+			}
+			break;
+		case AGENT_OP_LOG_NOT:
+			NEED(1);
+			TOP = !TOP;
+			break;
+		case AGENT_OP_BIT_AND:
+			NEED(2);
+			NEXT &= TOP;
+			sp--;
+			break;
+		case AGENT_OP_BIT_OR:
+			NEED(2);
+			NEXT |= TOP;
+			sp--;
+			break;
+		case AGENT_OP_BIT_XOR:
+			NEED(2);
+			NEXT ^= TOP;
+			sp--;
+			break;
+		case AGENT_OP_BIT_NOT:
+			NEED(1);
+			TOP = ~TOP;
+			break;
+		case AGENT_OP_EQUAL:
+			NEED(2);
+			NEXT = NEXT == TOP;
+			sp--;
+			break;
+		case AGENT_OP_LESS_SIGNED:
+			NEED(2);
+			NEXT = (int64_t)NEXT < (int64_t)TOP;
+			sp--;
+			break;
+		case AGENT_OP_LESS_UNSIGNED:
+			NEED(2);
+			NEXT = NEXT < TOP;
+			sp--;
+			break;
+		case AGENT_OP_EXT:
+			NEED(1);
+			OPERAND(1, a);
+			if (a > 0 && a < 64)
+				TOP = (uint64_t)((int64_t)(TOP << (64 - a)) >> (64 - a));
+			break;
+		case AGENT_OP_ZERO_EXT:
+			NEED(1);
+			OPERAND(1, a);
+			if (a < 64)
+				TOP &= (UINT64_C(1) << a) - 1;
+			break;
+		case AGENT_OP_REF8:
+		case AGENT_OP_REF16:
+		case AGENT_OP_REF32:
+		case AGENT_OP_REF64:
+			NEED(1);
+			retval = agent_expr_ref(target, TOP, 1 << (op - AGENT_OP_REF8), &TOP);
+			if (retval != ERROR_OK)
+				return retval;
+			break;
+		case AGENT_OP_IF_GOTO:
+			NEED(1);
+			OPERAND(2, a);
+			if (stack[--sp])
+				pc = a;
+			break;
+		case AGENT_OP_GOTO:
+			OPERAND(2, a);
+			pc = a;
+			break;
+		case AGENT_OP_CONST8:
+			OPERAND(1, a);
+			PUSH(a);
+			break;
+		case AGENT_OP_CONST16:
+			OPERAND(2, a);
+			PUSH(a);
+			break;
+		case AGENT_OP_CONST32:
+			OPERAND(4, a);
+			PUSH(a);
+			break;
+		case AGENT_OP_CONST64:
+			OPERAND(8, a);
+			PUSH(a);
+			break;
+		case AGENT_OP_REG:
+			OPERAND(2, a);
+			retval = agent_expr_reg(target, a, &b);
+			if (retval != ERROR_OK)
+				return retval;
+			PUSH(b);
+			break;
+		case AGENT_OP_END:
+			NEED(1);
+			*result = TOP;
+			return ERROR_OK;
+		case AGENT_OP_DUP:
+			NEED(1);
+			PUSH(TOP);
+			break;
+		case AGENT_OP_POP:
+			NEED(1);
+			sp--;
+			break;
+		case AGENT_OP_SWAP:
+			NEED(2);
+			a = TOP;
+			TOP = NEXT;
+			NEXT = a;
+			break;
+		case AGENT_OP_PICK:
+			OPERAND(1, a);
+			NEED(a + 1);
+			PUSH(stack[sp - 1 - a]);
+			break;
+		case AGENT_OP_ROT:
+			/* a b c => c a b */
+			NEED(3);
+			a = TOP;
+			TOP = NEXT;
+			NEXT = stack[sp - 3];
+			stack[sp - 3] = a;
+			break;
+		default:
+			LOG_DEBUG("agent expression opcode 0x%02" PRIx8 " not supported", op);
+			return ERROR_NOT_IMPLEMENTED;
+		}
+	}
+
+	LOG_DEBUG("agent expression did not end after %d steps", AGENT_EXPR_MAX_STEPS);
+	return ERROR_FAIL;
+
+truncated:
+	LOG_DEBUG("agent expression runs past its end");
+	return ERROR_FAIL;
+underflow:
+	LOG_DEBUG("agent expression stack underflow");
+	return ERROR_FAIL;
+overflow:
+	LOG_DEBUG("agent expression stack overflow");
+	return ERROR_FAIL;
+
+#undef OPERAND
+#undef NEED
+#undef PUSH
+#undef TOP
+#undef NEXT
+}
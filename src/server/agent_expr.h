@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_SERVER_AGENT_EXPR_H
+#define OPENOCD_SERVER_AGENT_EXPR_H
+
+#include <helper/types.h>
+
+struct target;
+
+/**
+ * Agent expression: bytecode sent by GDB to be evaluated by the stub,
+ * see "Agent Expressions" in the GDB manual.
+ */
+struct agent_expr {
+	unsigned int length;
+	uint8_t *bytes;
+};
+
+/**
+ * Parse the "length,bytes" form of an agent expression in a GDB packet,
+ * with the bytes in hexadecimal.
+ * @param packet start of the expression.
+ * @param end where the end of the expression is stored.
+ * @param expr where the new expression is stored.
+ * @returns ERROR_OK on success, ERROR_FAIL on a malformed expression.
+ */
+int agent_expr_parse(const char *packet, const char **end, struct agent_expr **expr);
+
+void agent_expr_free(struct agent_expr *expr);
+
+/**
+ * Called by the trace opcodes to collect @a size bytes of target memory
+ * at @a address; for "tracenz", @a nul_terminated is set and the
+ * collection stops after the first zero byte.
+ */
+typedef int (*agent_expr_trace_fn)(void *priv, target_addr_t address,
+		uint32_t size, bool nul_terminated);
+
+/**
+ * Evaluate @a expr on the halted @a target.
+ * @param target the target whose registers and memory are used.
+ * @param expr the expression.
+ * @param trace called by the trace opcodes, or NULL to ignore them.
+ * @param priv passed to @a trace.
+ * @param result where the value on the top of the stack is stored.
+ * @returns ERROR_OK on success, an error when the evaluation failed.
+ */
+int agent_expr_eval(struct target *target, const struct agent_expr *expr,
+		agent_expr_trace_fn trace, void *priv, uint64_t *result);
+
+#endif /* OPENOCD_SERVER_AGENT_EXPR_H */
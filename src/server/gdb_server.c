@@ -38,6 +38,10 @@
 #include "gdb_server.h"
 #include <target/image.h>
 #include <jtag/jtag.h>
+#include "agent_expr.h"
+#include "tracepoint.h"
+#include <helper/stats.h>
+#include <helper/time_support.h>
 #include "rtos/rtos.h"
 #include "target/smp.h"
 
@@ -59,9 +63,26 @@ enum gdb_output_flag {
 	GDB_OUTPUT_ALL,
 };
 
-struct target_desc_format {
-	char *tdesc;
-	uint32_t tdesc_length;
+/* target side conditions of a breakpoint, it stops if any is true */
+struct gdb_bp_condition {
+	target_addr_t address;
+	unsigned int num_exprs;
+	struct agent_expr **exprs;
+	struct gdb_bp_condition *next;
+};
+
+/* a core of the SMP group, seen by GDB as a thread in non-stop mode */
+struct gdb_nonstop_thread {
+	struct target *target;
+	/* smp setting of the target, restored when non-stop mode ends */
+	int smp;
+	/* GDB knows the thread as running */
+	bool running;
+	bool stepping;
+	/* stopped by a vCont;t action, reported with signal 0 */
+	bool halt_requested;
+	/* the stop was not yet reported to GDB */
+	bool stop_pending;
 };
 
 /* private connection data for GDB */
@@ -72,6 +93,10 @@ struct gdb_connection {
 	bool ctrl_c;
 	enum target_state frontend_state;
 	struct image *vflash_image;
+	/* set once the complete sectors of vflash_image are being written
+	 * before vFlashDone, bytes written so far */
+	bool vflash_started;
+	uint32_t vflash_written;
 	bool closed;
 	/* set to prevent re-entrance from log messages during gdb_get_packet()
 	 * and gdb_put_packet(). */
@@ -93,14 +118,24 @@ struct gdb_connection {
 	bool attached;
 	/* set when extended protocol is used */
 	bool extended_protocol;
-	/* temporarily used for target description support */
-	struct target_desc_format target_desc;
 	/* temporarily used for thread list support */
 	char *thread_list;
 	/* flag to mask the output from gdb_log_callback() */
 	enum gdb_output_flag output_flag;
 	/* Unique index for this GDB connection. */
 	unsigned int unique_index;
+	/* breakpoint conditions evaluated without waking GDB */
+	struct gdb_bp_condition *bp_conditions;
+	/* tracepoints and trace frames */
+	struct tracepoint_state *trace;
+	/* non-stop mode: cores halt and resume independently */
+	bool non_stop;
+	struct gdb_nonstop_thread *threads;
+	unsigned int num_threads;
+	/* thread whose stop was sent to GDB, until GDB acknowledges it */
+	int notified_thread;
+	/* target of the GDB service before non-stop mode */
+	struct target *nonstop_target;
 };
 
 #if 0
@@ -109,6 +144,81 @@ struct gdb_connection {
 
 static struct gdb_connection *current_gdb_connection;
 
+/* memory read from a halted target, see gdb_read_buffer_shared() */
+struct gdb_mem_cache_block {
+	target_addr_t address;
+	uint32_t size;
+	uint8_t *data;
+	struct gdb_mem_cache_block *next;
+};
+
+/*
+ * State shared by the GDB connections to a target.
+ *
+ * The XML documents served to GDB are kept as long as the registers and
+ * flash banks of the target stay the same. These are identified by a hash
+ * of the register list and of the bank layout, which is much cheaper to
+ * compute than the documents themselves.
+ */
+struct gdb_target_cache {
+	struct target *target;
+	char *tdesc;
+	size_t tdesc_length;
+	uint64_t tdesc_key;
+	char *memory_map;
+	size_t memory_map_length;
+	uint64_t memory_map_key;
+	/* memory read while halted, valid for one target_memory_generation() */
+	struct gdb_mem_cache_block *mem_blocks;
+	uint32_t mem_size;
+	unsigned int mem_generation;
+	struct gdb_target_cache *next;
+};
+
+#define GDB_MEM_CACHE_SIZE	(64 * 1024)
+
+static struct gdb_target_cache *gdb_target_caches;
+
+static struct gdb_target_cache *gdb_target_cache_get(struct target *target)
+{
+	struct gdb_target_cache *cache;
+
+	for (cache = gdb_target_caches; cache; cache = cache->next)
+		if (cache->target == target)
+			return cache;
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+	cache->target = target;
+	cache->next = gdb_target_caches;
+	gdb_target_caches = cache;
+	return cache;
+}
+
+static void gdb_mem_cache_clear(struct gdb_target_cache *cache)
+{
+	while (cache->mem_blocks) {
+		struct gdb_mem_cache_block *block = cache->mem_blocks;
+		cache->mem_blocks = block->next;
+		free(block->data);
+		free(block);
+	}
+	cache->mem_size = 0;
+}
+
+/* number of GDB connections sharing the target of @a connection */
+static unsigned int gdb_other_connections(struct connection *connection)
+{
+	unsigned int count = 0;
+
+	for (struct connection *c = connection->service->connections; c; c = c->next)
+		if (c != connection && c->priv)
+			count++;
+
+	return count;
+}
+
 static int gdb_breakpoint_override;
 static enum breakpoint_type gdb_breakpoint_override_type;
 
@@ -926,6 +1036,118 @@ static void gdb_fileio_reply(struct target *target, struct connection *connectio
 	}
 }
 
+static void gdb_bp_condition_free(struct gdb_bp_condition *condition)
+{
+	for (unsigned int i = 0; i < condition->num_exprs; i++)
+		agent_expr_free(condition->exprs[i]);
+	free(condition->exprs);
+	free(condition);
+}
+
+/* Returns true if the breakpoint at @a address had conditions */
+static bool gdb_bp_condition_remove(struct gdb_connection *gdb_connection,
+		target_addr_t address)
+{
+	struct gdb_bp_condition **p = &gdb_connection->bp_conditions;
+
+	while (*p) {
+		struct gdb_bp_condition *condition = *p;
+		if (condition->address == address) {
+			*p = condition->next;
+			gdb_bp_condition_free(condition);
+			return true;
+		}
+		p = &condition->next;
+	}
+
+	return false;
+}
+
+/* Parse the ";X len,expr" conditions following a Z0/Z1 packet */
+static int gdb_bp_condition_parse(const char *packet, target_addr_t address,
+		struct gdb_bp_condition **result)
+{
+	struct gdb_bp_condition *condition = calloc(1, sizeof(*condition));
+	if (!condition)
+		return ERROR_FAIL;
+	condition->address = address;
+
+	while (packet[0] == ';' && packet[1] == 'X') {
+		struct agent_expr *expr;
+		struct agent_expr **exprs;
+
+		if (agent_expr_parse(packet + 2, &packet, &expr) != ERROR_OK) {
+			gdb_bp_condition_free(condition);
+			return ERROR_FAIL;
+		}
+
+		exprs = realloc(condition->exprs, (condition->num_exprs + 1) * sizeof(*exprs));
+		if (!exprs) {
+			agent_expr_free(expr);
+			gdb_bp_condition_free(condition);
+			return ERROR_FAIL;
+		}
+		condition->exprs = exprs;
+		condition->exprs[condition->num_exprs++] = expr;
+	}
+
+	*result = condition;
+	return ERROR_OK;
+}
+
+/*
+ * Returns true when the target halted on a breakpoint whose conditions are
+ * all false, so that it can be resumed without reporting the stop to GDB.
+ * A condition which can't be evaluated counts as true.
+ */
+static bool gdb_bp_condition_false(struct target *target,
+		struct gdb_connection *gdb_connection)
+{
+	if (!gdb_connection->bp_conditions
+			|| target->state != TARGET_HALTED
+			|| target->debug_reason != DBG_REASON_BREAKPOINT)
+		return false;
+
+	struct reg *pc = register_get_by_name(target->reg_cache, "pc", true);
+	if (!pc || (!pc->valid && pc->type->get(pc) != ERROR_OK))
+		return false;
+	target_addr_t address = buf_get_u64(pc->value, 0, MIN(pc->size, 64));
+
+	struct gdb_bp_condition *condition = gdb_connection->bp_conditions;
+	while (condition && condition->address != address)
+		condition = condition->next;
+	if (!condition)
+		return false;
+
+	for (unsigned int i = 0; i < condition->num_exprs; i++) {
+		uint64_t value;
+		if (agent_expr_eval(target, condition->exprs[i], NULL, NULL, &value) != ERROR_OK
+				|| value)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Resume at once a target which halted while GDB continues it, when the
+ * stop is not to be reported. Returns true if the target was resumed.
+ */
+static bool gdb_resume_silently(struct target *target,
+		struct gdb_connection *gdb_connection)
+{
+	/* data is collected at tracepoints, the stop is reported only
+	 * if GDB has a breakpoint at the same address */
+	if (tracepoint_hit(gdb_connection->trace, target) == TRACEPOINT_HIT_RESUME
+			&& target_resume(target, 1, 0, 1, 0) == ERROR_OK)
+		return true;
+
+	/* resume at once if the breakpoint condition is false, the
+	 * breakpoint is stepped over by the target */
+	return gdb_bp_condition_false(target, gdb_connection)
+		&& target_resume(target, 1, 0, 1, 0) == ERROR_OK;
+}
+
 static void gdb_frontend_halted(struct target *target, struct connection *connection)
 {
 	struct gdb_connection *gdb_connection = connection->priv;
@@ -940,6 +1162,9 @@ static void gdb_frontend_halted(struct target *target, struct connection *connec
 	 * that are to be ignored.
 	 */
 	if (gdb_connection->frontend_state == TARGET_RUNNING) {
+		if (gdb_running_type == 'c' && gdb_resume_silently(target, gdb_connection))
+			return;
+
 		/* stop forwarding log packets! */
 		gdb_connection->output_flag = GDB_OUTPUT_NO;
 
@@ -951,11 +1176,392 @@ static void gdb_frontend_halted(struct target *target, struct connection *connec
 	}
 }
 
+/*
+ * Non-stop mode.
+ *
+ * The cores of the SMP group are presented to GDB as threads, numbered from
+ * one, and the smp coupling of the group is turned off so that a core halts
+ * without halting the others. Stops are sent to GDB as %Stop notifications,
+ * one at a time; GDB fetches the next one with vStopped.
+ */
+
+static int gdb_nonstop_find(struct gdb_connection *gdb_connection,
+		struct target *target)
+{
+	for (unsigned int i = 0; i < gdb_connection->num_threads; i++)
+		if (gdb_connection->threads[i].target == target)
+			return i;
+
+	return -1;
+}
+
+static int gdb_nonstop_start(struct connection *connection)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+	struct gdb_service *gdb_service = connection->service->priv;
+	struct target *target = gdb_service->target;
+	struct target_list *head;
+	unsigned int count = 1;
+
+	if (gdb_connection->non_stop)
+		return ERROR_OK;
+
+	/* the selected core and the smp coupling are shared by the connections */
+	if (gdb_other_connections(connection)) {
+		LOG_TARGET_ERROR(target, "non-stop mode needs the only GDB connection to the target");
+		return ERROR_FAIL;
+	}
+
+	if (!list_empty(target->smp_targets)) {
+		count = 0;
+		foreach_smp_target(head, target->smp_targets)
+			count++;
+	}
+
+	struct gdb_nonstop_thread *threads = calloc(count, sizeof(*threads));
+	if (!threads)
+		return ERROR_FAIL;
+
+	if (list_empty(target->smp_targets)) {
+		threads[0].target = target;
+	} else {
+		unsigned int i = 0;
+		foreach_smp_target(head, target->smp_targets)
+			threads[i++].target = head->target;
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		if (threads[i].target->rtos) {
+			LOG_TARGET_ERROR(threads[i].target,
+				"non-stop mode is not supported with an RTOS, cores are shown as threads");
+			free(threads);
+			return ERROR_FAIL;
+		}
+		/* turning smp off doesn't take the core out of its halt group */
+		if (threads[i].target->smp_hw_halt_group) {
+			LOG_TARGET_ERROR(threads[i].target,
+				"non-stop mode is not supported with hardware halt groups");
+			free(threads);
+			return ERROR_FAIL;
+		}
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		threads[i].smp = threads[i].target->smp;
+		threads[i].target->smp = 0;
+		threads[i].running = threads[i].target->state == TARGET_RUNNING;
+	}
+
+	gdb_connection->threads = threads;
+	gdb_connection->num_threads = count;
+	gdb_connection->notified_thread = -1;
+	gdb_connection->nonstop_target = target;
+	gdb_connection->non_stop = true;
+
+	LOG_TARGET_DEBUG(target, "non-stop mode, %u threads", count);
+	return ERROR_OK;
+}
+
+static void gdb_nonstop_stop(struct connection *connection)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+	struct gdb_service *gdb_service = connection->service->priv;
+
+	if (!gdb_connection->non_stop)
+		return;
+
+	for (unsigned int i = 0; i < gdb_connection->num_threads; i++)
+		gdb_connection->threads[i].target->smp = gdb_connection->threads[i].smp;
+
+	gdb_service->target = gdb_connection->nonstop_target;
+	free(gdb_connection->threads);
+	gdb_connection->threads = NULL;
+	gdb_connection->num_threads = 0;
+	gdb_connection->non_stop = false;
+}
+
+static int gdb_nonstop_stop_reply(struct gdb_connection *gdb_connection,
+		int index, char *reply, size_t reply_size)
+{
+	struct gdb_nonstop_thread *thread = &gdb_connection->threads[index];
+	int signal_var = thread->halt_requested ? 0 : gdb_last_signal(thread->target);
+
+	return snprintf(reply, reply_size, "T%2.2xthread:%x;", signal_var, index + 1);
+}
+
+/* Send a notification, which GDB does not acknowledge */
+static int gdb_put_notification(struct connection *connection, const char *buffer)
+{
+	unsigned char checksum = 0;
+	char buf[128];
+
+	int len = snprintf(buf, sizeof(buf) - 3, "%%%s", buffer);
+	for (int i = 1; i < len; i++)
+		checksum += buf[i];
+	len += sprintf(buf + len, "#%2.2x", checksum);
+
+	LOG_DEBUG("sending notification '%s'", buf);
+
+	return gdb_write(connection, buf, len);
+}
+
+/* Report the first pending stop, unless GDB did not acknowledge the last one */
+static void gdb_nonstop_notify(struct connection *connection)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+	char reply[64];
+
+	if (gdb_connection->notified_thread >= 0)
+		return;
+
+	for (unsigned int i = 0; i < gdb_connection->num_threads; i++) {
+		if (!gdb_connection->threads[i].stop_pending)
+			continue;
+
+		int len = snprintf(reply, sizeof(reply), "Stop:");
+		gdb_nonstop_stop_reply(gdb_connection, i, reply + len, sizeof(reply) - len);
+		gdb_put_notification(connection, reply);
+		gdb_connection->notified_thread = i;
+		return;
+	}
+}
+
+static void gdb_nonstop_halted(struct target *target, struct connection *connection)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+	int index = gdb_nonstop_find(gdb_connection, target);
+
+	if (index < 0 || target->state != TARGET_HALTED)
+		return;
+
+	struct gdb_nonstop_thread *thread = &gdb_connection->threads[index];
+	if (!thread->running)
+		return;
+
+	if (!thread->stepping && !thread->halt_requested
+			&& gdb_resume_silently(target, gdb_connection))
+		return;
+
+	thread->running = false;
+	thread->stop_pending = true;
+	gdb_nonstop_notify(connection);
+}
+
+/*
+ * Reply to '?' or to vStopped with the next pending stop, or "OK" when all
+ * were reported.
+ */
+static int gdb_nonstop_next_stop(struct connection *connection)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+	char reply[64];
+
+	gdb_connection->notified_thread = -1;
+
+	for (unsigned int i = 0; i < gdb_connection->num_threads; i++) {
+		if (!gdb_connection->threads[i].stop_pending)
+			continue;
+
+		int len = gdb_nonstop_stop_reply(gdb_connection, i, reply, sizeof(reply));
+		gdb_connection->notified_thread = i;
+		return gdb_put_packet(connection, reply, len);
+	}
+
+	return gdb_put_packet(connection, "OK", 2);
+}
+
+static int gdb_nonstop_status_packet(struct connection *connection)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+
+	/* all stopped threads are reported again */
+	for (unsigned int i = 0; i < gdb_connection->num_threads; i++) {
+		struct gdb_nonstop_thread *thread = &gdb_connection->threads[i];
+		thread->running = thread->target->state == TARGET_RUNNING;
+		thread->stop_pending = !thread->running;
+	}
+
+	return gdb_nonstop_next_stop(connection);
+}
+
+static int gdb_nonstop_stopped_packet(struct connection *connection)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+
+	if (gdb_connection->notified_thread >= 0)
+		gdb_connection->threads[gdb_connection->notified_thread].stop_pending = false;
+
+	return gdb_nonstop_next_stop(connection);
+}
+
+/* Parse a thread id, -1 for all threads */
+static int gdb_nonstop_parse_thread(struct gdb_connection *gdb_connection,
+		const char *str, const char **end)
+{
+	char *p;
+	long tid = strtol(str, &p, 16);
+
+	if (end)
+		*end = p;
+
+	if (tid == -1)
+		return -1;
+	if (tid <= 0 || (unsigned long)tid > gdb_connection->num_threads)
+		return -2;
+
+	return tid - 1;
+}
+
+/* vCont;action[:thread-id]... the first action matching a thread applies */
+static int gdb_nonstop_vcont_packet(struct connection *connection, const char *packet)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+	unsigned int count = gdb_connection->num_threads;
+	char actions[count];
+	const char *parse = packet + 5;
+
+	memset(actions, 0, count);
+
+	while (*parse == ';') {
+		char action = parse[1];
+		int index = -1;
+		char *end;
+
+		if (!action || !strchr("cCsSt", action))
+			return gdb_put_packet(connection, "E01", 3);
+
+		parse += 2;
+		/* the signal of C and S is not delivered */
+		if (action == 'C' || action == 'S') {
+			strtoul(parse, &end, 16);
+			parse = end;
+			action = (action == 'C') ? 'c' : 's';
+		}
+		if (*parse == ':') {
+			index = gdb_nonstop_parse_thread(gdb_connection, parse + 1, &parse);
+			if (index < -1)
+				return gdb_put_packet(connection, "E01", 3);
+		}
+
+		for (unsigned int i = 0; i < count; i++)
+			if (!actions[i] && (index < 0 || (unsigned int)index == i))
+				actions[i] = action;
+	}
+
+	/* the stops are reported with notifications after this reply */
+	int retval = gdb_put_packet(connection, "OK", 2);
+
+	for (unsigned int i = 0; i < count; i++) {
+		struct gdb_nonstop_thread *thread = &gdb_connection->threads[i];
+		struct target *target = thread->target;
+
+		switch (actions[i]) {
+		case 'c':
+		case 's':
+			if (thread->running || target->state != TARGET_HALTED)
+				break;
+			thread->running = true;
+			thread->stepping = actions[i] == 's';
+			thread->halt_requested = false;
+			thread->stop_pending = false;
+			target_call_event_callbacks(target, TARGET_EVENT_GDB_START);
+			if (thread->stepping) {
+				if (target_step(target, 1, 0, 0) != ERROR_OK)
+					LOG_TARGET_ERROR(target, "step failed");
+				target_poll(target);
+				/* in case the target did not send the halted event */
+				gdb_nonstop_halted(target, connection);
+			} else if (target_resume(target, 1, 0, 0, 0) != ERROR_OK) {
+				LOG_TARGET_ERROR(target, "resume failed");
+				target_poll(target);
+			}
+			break;
+		case 't':
+			if (!thread->running)
+				break;
+			thread->halt_requested = true;
+			if (target_halt(target) != ERROR_OK)
+				LOG_TARGET_ERROR(target, "halt failed");
+			break;
+		default:
+			break;
+		}
+	}
+
+	return retval;
+}
+
+/* Thread packets in non-stop mode, returns false if not one */
+static bool gdb_nonstop_thread_packet(struct connection *connection, const char *packet)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+	struct gdb_service *gdb_service = connection->service->priv;
+	char reply[128];
+	int index;
+
+	if (packet[0] == 'H' && packet[1] == 'g') {
+		index = gdb_nonstop_parse_thread(gdb_connection, packet + 2, NULL);
+		if (index < -1 && strtol(packet + 2, NULL, 16) != 0) {
+			gdb_put_packet(connection, "E01", 3);
+			return true;
+		}
+		/* the selected core serves the registers and memory packets */
+		if (index >= 0)
+			gdb_service->target = gdb_connection->threads[index].target;
+		gdb_put_packet(connection, "OK", 2);
+	} else if (packet[0] == 'H') {
+		gdb_put_packet(connection, "OK", 2);
+	} else if (packet[0] == 'T') {
+		index = gdb_nonstop_parse_thread(gdb_connection, packet + 1, NULL);
+		if (index >= 0)
+			gdb_put_packet(connection, "OK", 2);
+		else
+			gdb_put_packet(connection, "E01", 3);
+	} else if (strcmp(packet, "qfThreadInfo") == 0) {
+		int len = snprintf(reply, sizeof(reply), "m");
+		for (unsigned int i = 0; i < gdb_connection->num_threads && len < 100; i++)
+			len += snprintf(reply + len, sizeof(reply) - len, "%s%x", i ? "," : "", i + 1);
+		gdb_put_packet(connection, reply, len);
+	} else if (strcmp(packet, "qsThreadInfo") == 0) {
+		gdb_put_packet(connection, "l", 1);
+	} else if (strcmp(packet, "qC") == 0) {
+		index = gdb_nonstop_find(gdb_connection, gdb_service->target);
+		int len = snprintf(reply, sizeof(reply), "QC%x", index + 1);
+		gdb_put_packet(connection, reply, len);
+	} else if (strncmp(packet, "qThreadExtraInfo,", 17) == 0) {
+		index = gdb_nonstop_parse_thread(gdb_connection, packet + 17, NULL);
+		if (index < 0) {
+			gdb_put_packet(connection, "E01", 3);
+			return true;
+		}
+		struct target *target = gdb_connection->threads[index].target;
+		char info[sizeof(reply) / 2];
+		snprintf(info, sizeof(info), "%s %s", target_name(target),
+			target_state_name(target));
+		size_t len = hexify(reply, (const uint8_t *)info, strlen(info), sizeof(reply));
+		gdb_put_packet(connection, reply, len);
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
 static int gdb_target_callback_event_handler(struct target *target,
 		enum target_event event, void *priv)
 {
 	struct connection *connection = priv;
 	struct gdb_service *gdb_service = connection->service->priv;
+	struct gdb_connection *gdb_connection = connection->priv;
+
+	if (gdb_connection->non_stop) {
+		if (event == TARGET_EVENT_GDB_HALT)
+			gdb_nonstop_halted(target, connection);
+		else if (event == TARGET_EVENT_HALTED
+				&& gdb_nonstop_find(gdb_connection, target) >= 0)
+			target_call_event_callbacks(target, TARGET_EVENT_GDB_END);
+		return ERROR_OK;
+	}
 
 	if (gdb_service->target != target)
 		return ERROR_OK;
@@ -983,6 +1589,17 @@ static int gdb_new_connection(struct connection *connection)
 	static unsigned int next_unique_id = 1;
 
 	target = get_target_from_connection(connection);
+
+	/* see gdb_nonstop_start() */
+	for (struct connection *c = connection->service->connections; c; c = c->next) {
+		struct gdb_connection *other = c->priv;
+		if (other && other->non_stop) {
+			LOG_TARGET_ERROR(target, "a GDB connection to the target uses non-stop mode");
+			free(gdb_connection);
+			return ERROR_FAIL;
+		}
+	}
+
 	connection->priv = gdb_connection;
 	connection->cmd_ctx->current_target = target;
 
@@ -992,6 +1609,19 @@ static int gdb_new_connection(struct connection *connection)
 	gdb_connection->ctrl_c = false;
 	gdb_connection->frontend_state = TARGET_HALTED;
 	gdb_connection->vflash_image = NULL;
+	gdb_connection->bp_conditions = NULL;
+	gdb_connection->trace = tracepoint_state_new();
+	gdb_connection->non_stop = false;
+	gdb_connection->threads = NULL;
+	gdb_connection->num_threads = 0;
+	gdb_connection->notified_thread = -1;
+	gdb_connection->nonstop_target = NULL;
+	if (!gdb_connection->trace) {
+		free(gdb_connection);
+		return ERROR_FAIL;
+	}
+	gdb_connection->vflash_started = false;
+	gdb_connection->vflash_written = 0;
 	gdb_connection->closed = false;
 	gdb_connection->busy = false;
 	gdb_connection->noack_mode = 0;
@@ -999,8 +1629,6 @@ static int gdb_new_connection(struct connection *connection)
 	gdb_connection->mem_write_error = false;
 	gdb_connection->attached = true;
 	gdb_connection->extended_protocol = false;
-	gdb_connection->target_desc.tdesc = NULL;
-	gdb_connection->target_desc.tdesc_length = 0;
 	gdb_connection->thread_list = NULL;
 	gdb_connection->output_flag = GDB_OUTPUT_NO;
 	gdb_connection->unique_index = next_unique_id++;
@@ -1008,12 +1636,17 @@ static int gdb_new_connection(struct connection *connection)
 	/* output goes through gdb connection */
 	command_set_output_handler(connection->cmd_ctx, gdb_output, connection);
 
+	/* the other GDB connections to the target keep it as they set it up */
+	bool first = !gdb_other_connections(connection);
+
 	/* we must remove all breakpoints registered to the target as a previous
 	 * GDB session could leave dangling breakpoints if e.g. communication
 	 * timed out.
 	 */
-	breakpoint_clear_target(target);
-	watchpoint_clear_target(target);
+	if (first) {
+		breakpoint_clear_target(target);
+		watchpoint_clear_target(target);
+	}
 
 	/* Since version 3.95 (gdb-19990504), with the exclusion of 6.5~6.8, GDB
 	 * sends an ACK at connection with the following comment in its source code:
@@ -1028,16 +1661,20 @@ static int gdb_new_connection(struct connection *connection)
 	if (initial_ack != '+')
 		gdb_putback_char(connection, initial_ack);
 
-	target_call_event_callbacks(target, TARGET_EVENT_GDB_ATTACH);
+	if (first) {
+		target_call_event_callbacks(target, TARGET_EVENT_GDB_ATTACH);
 
-	if (target->rtos) {
 		/* clean previous rtos session if supported*/
-		if (target->rtos->type->clean)
+		if (target->rtos && target->rtos->type->clean)
 			target->rtos->type->clean(target);
+	} else {
+		LOG_TARGET_INFO(target, "GDB connection %d shares the target with %u other connection(s)",
+				gdb_connection->unique_index, gdb_other_connections(connection));
+	}
 
-		/* update threads */
+	/* update threads */
+	if (target->rtos)
 		rtos_update_threads(target);
-	}
 
 	if (gdb_use_memory_map) {
 		/* Connect must fail if the memory map can't be set up correctly.
@@ -1094,6 +1731,9 @@ static int gdb_connection_closed(struct connection *connection)
 	struct target *target;
 	struct gdb_connection *gdb_connection = connection->priv;
 
+	/* back to all-stop, the SMP group halts as a whole again */
+	gdb_nonstop_stop(connection);
+
 	target = get_target_from_connection(connection);
 
 	/* we're done forwarding messages. Tear down callback before
@@ -1107,8 +1747,19 @@ static int gdb_connection_closed(struct connection *connection)
 		target_state_name(target),
 		gdb_actual_connections);
 
+	while (gdb_connection->bp_conditions) {
+		struct gdb_bp_condition *condition = gdb_connection->bp_conditions;
+		gdb_connection->bp_conditions = condition->next;
+		gdb_bp_condition_free(condition);
+	}
+
+	tracepoint_state_free(gdb_connection->trace, target);
+
 	/* see if an image built with vFlash commands is left */
 	if (gdb_connection->vflash_image) {
+		if (gdb_connection->vflash_started)
+			target_call_event_callbacks(target,
+				TARGET_EVENT_GDB_FLASH_WRITE_END);
 		image_close(gdb_connection->vflash_image);
 		free(gdb_connection->vflash_image);
 		gdb_connection->vflash_image = NULL;
@@ -1124,7 +1775,8 @@ static int gdb_connection_closed(struct connection *connection)
 
 	target_call_event_callbacks(target, TARGET_EVENT_GDB_END);
 
-	target_call_event_callbacks(target, TARGET_EVENT_GDB_DETACH);
+	if (!gdb_other_connections(connection))
+		target_call_event_callbacks(target, TARGET_EVENT_GDB_DETACH);
 
 	return ERROR_OK;
 }
@@ -1232,9 +1884,92 @@ static int gdb_get_reg_value_as_str(struct target *target, char *tstr, struct re
 			tstr[len] = '\0';
 			return ERROR_OK;
 	}
-	memset(tstr, '0', len);
-	tstr[len] = '\0';
-	return ERROR_FAIL;
+	memset(tstr, '0', len);
+	tstr[len] = '\0';
+	return ERROR_FAIL;
+}
+
+/*
+ * Reply to 'g' (@a reg_num negative) or 'p' with the registers of the
+ * selected trace frame, those not collected read as unavailable.
+ */
+static int gdb_get_trace_registers_packet(struct connection *connection, int reg_num)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+	struct target *target = get_target_from_connection(connection);
+	struct reg **all_list, **reg_list;
+	int all_list_size, reg_list_size;
+	int reg_packet_size = 0;
+	int retval;
+
+	retval = target_get_gdb_reg_list_noread(target, &all_list, &all_list_size,
+			REG_CLASS_ALL);
+	if (retval != ERROR_OK)
+		return gdb_error(connection, retval);
+
+	if (reg_num < 0) {
+		retval = target_get_gdb_reg_list_noread(target, &reg_list, &reg_list_size,
+				REG_CLASS_GENERAL);
+		if (retval != ERROR_OK) {
+			free(all_list);
+			return gdb_error(connection, retval);
+		}
+	} else if (reg_num < all_list_size && all_list[reg_num]) {
+		reg_list = malloc(sizeof(*reg_list));
+		if (!reg_list) {
+			free(all_list);
+			return ERROR_FAIL;
+		}
+		reg_list[0] = all_list[reg_num];
+		reg_list_size = 1;
+	} else {
+		free(all_list);
+		return gdb_error(connection, ERROR_FAIL);
+	}
+
+	for (int i = 0; i < reg_list_size; i++) {
+		if (!reg_list[i] || !reg_list[i]->exist || reg_list[i]->hidden)
+			continue;
+		reg_packet_size += DIV_ROUND_UP(reg_list[i]->size, 8) * 2;
+	}
+
+	char *reg_packet = malloc(reg_packet_size + 1);
+	if (!reg_packet) {
+		free(reg_list);
+		free(all_list);
+		return ERROR_FAIL;
+	}
+
+	char *reg_packet_p = reg_packet;
+	for (int i = 0; i < reg_list_size; i++) {
+		struct reg *reg = reg_list[i];
+		if (!reg || !reg->exist || reg->hidden)
+			continue;
+
+		/* collected registers are numbered as in the REG_CLASS_ALL list */
+		const uint8_t *value = NULL;
+		for (int j = 0; j < all_list_size && !value; j++)
+			if (all_list[j] == reg)
+				value = tracepoint_frame_reg(gdb_connection->trace, j);
+
+		int len = DIV_ROUND_UP(reg->size, 8) * 2;
+		if (value) {
+			struct reg frame_reg = *reg;
+			frame_reg.value = (void *)value;
+			gdb_str_to_target(target, reg_packet_p, &frame_reg);
+		} else {
+			memset(reg_packet_p, 'x', len);
+		}
+		reg_packet_p += len;
+	}
+
+	gdb_put_packet(connection, reg_packet, reg_packet_size);
+
+	free(reg_packet);
+	free(reg_list);
+	free(all_list);
+
+	return ERROR_OK;
 }
 
 static int gdb_get_registers_packet(struct connection *connection,
@@ -1253,6 +1988,9 @@ static int gdb_get_registers_packet(struct connection *connection,
 	LOG_DEBUG("-");
 #endif
 
+	if (tracepoint_frame_selected(((struct gdb_connection *)connection->priv)->trace))
+		return gdb_get_trace_registers_packet(connection, -1);
+
 	if ((target->rtos) && (rtos_get_gdb_reg_list(connection) == ERROR_OK))
 		return ERROR_OK;
 
@@ -1315,6 +2053,10 @@ static int gdb_set_registers_packet(struct connection *connection,
 	int retval;
 	char const *packet_p;
 
+	/* Cached thread state may no longer match the target */
+	if (target->rtos)
+		rtos_cache_invalidate(target->rtos);
+
 #ifdef _DEBUG_GDB_IO_
 	LOG_DEBUG("-");
 #endif
@@ -1382,6 +2124,9 @@ static int gdb_get_register_packet(struct connection *connection,
 	LOG_DEBUG("-");
 #endif
 
+	if (tracepoint_frame_selected(((struct gdb_connection *)connection->priv)->trace))
+		return gdb_get_trace_registers_packet(connection, reg_num);
+
 	if ((target->rtos) && (rtos_get_gdb_reg(connection, reg_num) == ERROR_OK))
 		return ERROR_OK;
 
@@ -1424,6 +2169,10 @@ static int gdb_set_register_packet(struct connection *connection,
 	int reg_list_size;
 	int retval;
 
+	/* Cached thread state may no longer match the target */
+	if (target->rtos)
+		rtos_cache_invalidate(target->rtos);
+
 #ifdef _DEBUG_GDB_IO_
 	LOG_DEBUG("-");
 #endif
@@ -1495,6 +2244,110 @@ static int gdb_error(struct connection *connection, int retval)
 	return ERROR_OK;
 }
 
+static bool gdb_smp_halted(struct target *target)
+{
+	struct target_list *head;
+
+	if (list_empty(target->smp_targets))
+		return target->state == TARGET_HALTED;
+
+	foreach_smp_target(head, target->smp_targets)
+		if (head->target->state != TARGET_HALTED)
+			return false;
+
+	return true;
+}
+
+/*
+ * Peripheral registers can change on their own or when read, and OpenOCD
+ * does not know where they are; only flash banks and the work area are
+ * known to be plain memory.
+ */
+static bool gdb_mem_cacheable(struct target *target, target_addr_t address,
+		uint32_t size)
+{
+	struct flash_bank *bank;
+
+	if (get_flash_bank_by_addr(target, address, false, &bank) == ERROR_OK && bank
+			&& size <= bank->size && address - bank->base <= bank->size - size)
+		return true;
+
+	target_addr_t work_area = target->working_area_virt_spec ?
+		target->working_area_virt : target->working_area_phys;
+	uint32_t work_size = target->working_area_size;
+
+	return (target->working_area_virt_spec || target->working_area_phys_spec)
+		&& address >= work_area && size <= work_size
+		&& address - work_area <= work_size - size;
+}
+
+/*
+ * Read target memory for a GDB connection. While the target is halted and
+ * shared with other GDB connections, each of them reads the code around the
+ * PC after every stop, to disassemble and unwind; keep what was read from
+ * flash and the work area until it may have changed, see
+ * target_memory_generation(). Stack and variables in other RAM are read from
+ * the target each time, see gdb_mem_cacheable().
+ */
+static int gdb_read_buffer_shared(struct connection *connection,
+		target_addr_t address, uint32_t size, uint8_t *buffer)
+{
+	struct target *target = get_target_from_connection(connection);
+	struct gdb_target_cache *cache;
+	struct gdb_mem_cache_block *block;
+
+	if (size > GDB_MEM_CACHE_SIZE || !gdb_other_connections(connection)
+			|| !gdb_smp_halted(target)
+			|| !gdb_mem_cacheable(target, address, size))
+		return target_read_buffer(target, address, size, buffer);
+
+	cache = gdb_target_cache_get(target);
+	if (!cache)
+		return target_read_buffer(target, address, size, buffer);
+
+	unsigned int generation = target_memory_generation(target);
+	if (cache->mem_generation != generation) {
+		gdb_mem_cache_clear(cache);
+		cache->mem_generation = generation;
+	}
+
+	for (block = cache->mem_blocks; block; block = block->next) {
+		if (address >= block->address && size <= block->size
+				&& address - block->address <= block->size - size) {
+			memcpy(buffer, block->data + (address - block->address), size);
+			return ERROR_OK;
+		}
+	}
+
+	int retval = target_read_buffer(target, address, size, buffer);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* the read may have run an algorithm or reset the target */
+	if (cache->mem_generation != target_memory_generation(target))
+		return ERROR_OK;
+
+	if (cache->mem_size + size > GDB_MEM_CACHE_SIZE)
+		gdb_mem_cache_clear(cache);
+
+	block = malloc(sizeof(*block));
+	if (!block)
+		return ERROR_OK;
+	block->data = malloc(size);
+	if (!block->data) {
+		free(block);
+		return ERROR_OK;
+	}
+	memcpy(block->data, buffer, size);
+	block->address = address;
+	block->size = size;
+	block->next = cache->mem_blocks;
+	cache->mem_blocks = block;
+	cache->mem_size += size;
+
+	return ERROR_OK;
+}
+
 static int gdb_read_memory_packet(struct connection *connection,
 		char const *packet, int packet_size)
 {
@@ -1530,11 +2383,23 @@ static int gdb_read_memory_packet(struct connection *connection,
 
 	LOG_DEBUG("addr: 0x%16.16" PRIx64 ", len: 0x%8.8" PRIx32 "", addr, len);
 
-	retval = ERROR_NOT_IMPLEMENTED;
-	if (target->rtos)
-		retval = rtos_read_buffer(target, addr, len, buffer);
-	if (retval == ERROR_NOT_IMPLEMENTED)
-		retval = target_read_buffer(target, addr, len, buffer);
+	struct gdb_connection *gdb_connection = connection->priv;
+	if (tracepoint_frame_selected(gdb_connection->trace)) {
+		/* reply with the collected part only, memory which was not
+		 * collected is unavailable */
+		len = tracepoint_frame_read_memory(gdb_connection->trace, addr, len, buffer);
+		if (!len) {
+			free(buffer);
+			return gdb_error(connection, ERROR_FAIL);
+		}
+		retval = ERROR_OK;
+	} else {
+		retval = ERROR_NOT_IMPLEMENTED;
+		if (target->rtos)
+			retval = rtos_read_buffer(target, addr, len, buffer);
+		if (retval == ERROR_NOT_IMPLEMENTED)
+			retval = gdb_read_buffer_shared(connection, addr, len, buffer);
+	}
 
 	if ((retval != ERROR_OK) && !gdb_report_data_abort) {
 		/* TODO : Here we have to lie and send back all zero's lest stack traces won't work.
@@ -1578,6 +2443,10 @@ static int gdb_write_memory_packet(struct connection *connection,
 	uint64_t addr = 0;
 	uint32_t len = 0;
 
+	/* Cached thread state may no longer match the target */
+	if (target->rtos)
+		rtos_cache_invalidate(target->rtos);
+
 	uint8_t *buffer;
 	int retval;
 
@@ -1629,6 +2498,10 @@ static int gdb_write_memory_binary_packet(struct connection *connection,
 	uint64_t addr = 0;
 	uint32_t len = 0;
 
+	/* Cached thread state may no longer match the target */
+	if (target->rtos)
+		rtos_cache_invalidate(target->rtos);
+
 	int retval = ERROR_OK;
 	/* Packets larger than fast_limit bytes will be acknowledged instantly on
 	 * the assumption that we're in a download and it's important to go as fast
@@ -1732,6 +2605,8 @@ static int gdb_breakpoint_watchpoint_packet(struct connection *connection,
 		char const *packet, int packet_size)
 {
 	struct target *target = get_target_from_connection(connection);
+	struct gdb_connection *gdb_connection = connection->priv;
+	struct gdb_bp_condition *condition = NULL;
 	int type;
 	enum breakpoint_type bp_type = BKPT_SOFT /* dummy init to avoid warning */;
 	enum watchpoint_rw wp_type = WPT_READ /* dummy init to avoid warning */;
@@ -1780,10 +2655,38 @@ static int gdb_breakpoint_watchpoint_packet(struct connection *connection,
 		case 0:
 		case 1:
 			if (packet[0] == 'Z') {
-				retval = breakpoint_add(target, address, size, bp_type);
+				if (*separator == ';') {
+					if (gdb_bp_condition_parse(separator, address, &condition) != ERROR_OK) {
+						LOG_ERROR("invalid breakpoint condition received, dropping connection");
+						return ERROR_SERVER_REMOTE_CLOSED;
+					}
+				}
+
+				tracepoint_breakpoint_kind(gdb_connection->trace, address, size);
+
+				/* GDB sends the breakpoint again when its conditions change */
+				bool had_condition = gdb_bp_condition_remove(gdb_connection, address);
+				if ((condition || had_condition) && breakpoint_find(target, address))
+					retval = ERROR_OK;
+				else if (tracepoint_share_breakpoint(gdb_connection->trace, address, true))
+					retval = ERROR_OK;
+				else
+					retval = breakpoint_add(target, address, size, bp_type);
+
+				if (retval == ERROR_OK && condition) {
+					condition->next = gdb_connection->bp_conditions;
+					gdb_connection->bp_conditions = condition;
+				} else if (condition) {
+					gdb_bp_condition_free(condition);
+				}
 			} else {
 				assert(packet[0] == 'z');
-				retval = breakpoint_remove(target, address);
+				gdb_bp_condition_remove(gdb_connection, address);
+				/* a running tracepoint still needs the breakpoint */
+				if (tracepoint_share_breakpoint(gdb_connection->trace, address, false))
+					retval = ERROR_OK;
+				else
+					retval = breakpoint_remove(target, address);
 			}
 			break;
 		case 2:
@@ -1894,35 +2797,52 @@ static int compare_bank(const void *a, const void *b)
 		return -1;
 }
 
-static int gdb_memory_map(struct connection *connection,
-		char const *packet, int packet_size)
+#define GDB_XML_KEY_INIT	0xcbf29ce484222325ull
+
+/* FNV-1a, one word at a time */
+static uint64_t gdb_xml_key_add(uint64_t key, uint64_t value)
+{
+	return (key ^ value) * 0x100000001b3ull;
+}
+
+static uint64_t gdb_memory_map_key(struct target *target)
+{
+	uint64_t key = GDB_XML_KEY_INIT;
+
+	for (unsigned int i = 0; i < flash_get_bank_count(); i++) {
+		struct flash_bank *p = get_flash_bank_by_num_noprobe(i);
+		if (p->target != target)
+			continue;
+
+		key = gdb_xml_key_add(key, (uintptr_t)p);
+		key = gdb_xml_key_add(key, p->base);
+		key = gdb_xml_key_add(key, p->size);
+		key = gdb_xml_key_add(key, p->num_sectors);
+		for (unsigned int j = 0; j < p->num_sectors; j++) {
+			key = gdb_xml_key_add(key, p->sectors[j].offset);
+			key = gdb_xml_key_add(key, p->sectors[j].size);
+		}
+	}
+
+	return key;
+}
+
+static int gdb_generate_memory_map(struct target *target, char **xml_out, int *length)
 {
 	/* We get away with only specifying flash here. Regions that are not
 	 * specified are treated as if we provided no memory map(if not we
 	 * could detect the holes and mark them as RAM).
-	 * Normally we only execute this code once, but no big deal if we
-	 * have to regenerate it a couple of times.
 	 */
 
-	struct target *target = get_target_from_connection(connection);
 	struct flash_bank *p;
 	char *xml = NULL;
 	int size = 0;
 	int pos = 0;
 	int retval = ERROR_OK;
 	struct flash_bank **banks;
-	int offset;
-	int length;
-	char *separator;
 	target_addr_t ram_start = 0;
 	unsigned int target_flash_banks = 0;
 
-	/* skip command character */
-	packet += 23;
-
-	offset = strtoul(packet, &separator, 16);
-	length = strtoul(separator + 1, &separator, 16);
-
 	xml_printf(&retval, &xml, &pos, &size, "<memory-map>\n");
 
 	/* Sort banks in ascending order.  We need to report non-flash
@@ -1938,7 +2858,6 @@ static int gdb_memory_map(struct connection *connection,
 		retval = get_flash_bank_by_num(i, &p);
 		if (retval != ERROR_OK) {
 			free(banks);
-			gdb_error(connection, retval);
 			return retval;
 		}
 		banks[target_flash_banks++] = p;
@@ -2024,20 +2943,67 @@ static int gdb_memory_map(struct connection *connection,
 
 	if (retval != ERROR_OK) {
 		free(xml);
-		gdb_error(connection, retval);
 		return retval;
 	}
 
-	if (offset + length > pos)
-		length = pos - offset;
+	*xml_out = xml;
+	*length = pos;
+	return ERROR_OK;
+}
+
+static int gdb_memory_map(struct connection *connection,
+		char const *packet, int packet_size)
+{
+	struct target *target = get_target_from_connection(connection);
+	struct gdb_target_cache *cache = gdb_target_cache_get(target);
+	int offset;
+	int length;
+	char *separator;
+	int retval;
+
+	if (!cache)
+		return gdb_error(connection, ERROR_FAIL);
+
+	/* skip command character */
+	packet += 23;
+
+	offset = strtoul(packet, &separator, 16);
+	length = strtoul(separator + 1, &separator, 16);
+
+	/* GDB reads the map in chunks, build it for the first one only and
+	 * again when flash banks were probed or changed */
+	if (!cache->memory_map || cache->memory_map_key != gdb_memory_map_key(target)) {
+		char *xml;
+		int xml_length;
+
+		free(cache->memory_map);
+		cache->memory_map = NULL;
+
+		retval = gdb_generate_memory_map(target, &xml, &xml_length);
+		if (retval != ERROR_OK) {
+			gdb_error(connection, retval);
+			return retval;
+		}
+
+		cache->memory_map = xml;
+		cache->memory_map_length = xml_length;
+		/* banks are probed now, take the key of the final layout */
+		cache->memory_map_key = gdb_memory_map_key(target);
+	}
+
+	if (offset < 0 || (size_t)offset > cache->memory_map_length)
+		offset = cache->memory_map_length;
+	if ((size_t)(offset + length) > cache->memory_map_length)
+		length = cache->memory_map_length - offset;
 
 	char *t = malloc(length + 1);
+	if (!t)
+		return ERROR_FAIL;
 	t[0] = 'l';
-	memcpy(t + 1, xml + offset, length);
+	memcpy(t + 1, cache->memory_map + offset, length);
 	gdb_put_packet(connection, t, length + 1);
 
 	free(t);
-	free(xml);
 	return ERROR_OK;
 }
 
@@ -2540,27 +3506,71 @@ error:
 	return retval;
 }
 
-static int gdb_get_target_description_chunk(struct target *target, struct target_desc_format *target_desc,
+static int gdb_target_description_key(struct target *target, uint64_t *key)
+{
+	struct reg **reg_list;
+	int reg_list_size;
+
+	int retval = smp_reg_list_noread(target, &reg_list, &reg_list_size,
+			REG_CLASS_ALL);
+	if (retval != ERROR_OK)
+		return retval;
+
+	const char *architecture = target_get_gdb_arch(target);
+	uint64_t k = gdb_xml_key_add(GDB_XML_KEY_INIT, (uintptr_t)architecture);
+	for (int i = 0; i < reg_list_size; i++) {
+		struct reg *reg = reg_list[i];
+		k = gdb_xml_key_add(k, (uintptr_t)reg);
+		if (!reg)
+			continue;
+		k = gdb_xml_key_add(k, (uintptr_t)reg->name);
+		k = gdb_xml_key_add(k, (uintptr_t)reg->feature);
+		k = gdb_xml_key_add(k, (uintptr_t)reg->reg_data_type);
+		k = gdb_xml_key_add(k, (uintptr_t)reg->group);
+		k = gdb_xml_key_add(k, reg->size);
+		k = gdb_xml_key_add(k, reg->exist | reg->hidden << 1 | reg->caller_save << 2);
+	}
+
+	free(reg_list);
+	*key = k;
+	return ERROR_OK;
+}
+
+static int gdb_get_target_description_chunk(struct target *target,
 		char **chunk, int32_t offset, uint32_t length)
 {
-	if (!target_desc) {
+	struct gdb_target_cache *cache = gdb_target_cache_get(target);
+	uint64_t key;
+
+	if (!cache || gdb_target_description_key(target, &key) != ERROR_OK) {
 		LOG_ERROR("Unable to Generate Target Description");
 		return ERROR_FAIL;
 	}
 
-	char *tdesc = target_desc->tdesc;
-	uint32_t tdesc_length = target_desc->tdesc_length;
+	/* the description is generated once per register layout */
+	if (!cache->tdesc || cache->tdesc_key != key) {
+		char *tdesc;
+
+		free(cache->tdesc);
+		cache->tdesc = NULL;
 
-	if (!tdesc) {
 		int retval = gdb_generate_target_description(target, &tdesc);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("Unable to Generate Target Description");
 			return ERROR_FAIL;
 		}
 
-		tdesc_length = strlen(tdesc);
+		cache->tdesc = tdesc;
+		cache->tdesc_length = strlen(tdesc);
+		cache->tdesc_key = key;
 	}
 
+	const char *tdesc = cache->tdesc;
+	uint32_t tdesc_length = cache->tdesc_length;
+
+	if (offset < 0 || (uint32_t)offset > tdesc_length)
+		offset = tdesc_length;
+
 	char transfer_type;
 
 	if (length < (tdesc_length - offset))
@@ -2581,16 +3591,8 @@ static int gdb_get_target_description_chunk(struct target *target, struct target
 	} else {
 		strncpy((*chunk) + 1, tdesc + offset, tdesc_length - offset);
 		(*chunk)[1 + (tdesc_length - offset)] = '\0';
-
-		/* After gdb-server sends out last chunk, invalidate tdesc. */
-		free(tdesc);
-		tdesc = NULL;
-		tdesc_length = 0;
 	}
 
-	target_desc->tdesc = tdesc;
-	target_desc->tdesc_length = tdesc_length;
-
 	return ERROR_OK;
 }
 
@@ -2695,11 +3697,50 @@ static int gdb_generate_thread_list(struct target *target, char **thread_list_ou
 	return retval;
 }
 
-static int gdb_get_thread_list_chunk(struct target *target, char **thread_list,
-		char **chunk, int32_t offset, uint32_t length)
+/* In non-stop mode, the cores are the threads */
+static int gdb_generate_nonstop_thread_list(struct gdb_connection *gdb_connection,
+		char **thread_list_out)
+{
+	int retval = ERROR_OK;
+	char *thread_list = NULL;
+	int pos = 0;
+	int size = 0;
+
+	xml_printf(&retval, &thread_list, &pos, &size,
+		   "<?xml version=\"1.0\"?>\n"
+		   "<threads>\n");
+
+	for (unsigned int i = 0; i < gdb_connection->num_threads; i++) {
+		struct target *target = gdb_connection->threads[i].target;
+		xml_printf(&retval, &thread_list, &pos, &size,
+			   "<thread id=\"%x\" name=\"%s\">Name: %s, %s</thread>\n",
+			   i + 1, target_name(target), target_name(target),
+			   target_state_name(target));
+	}
+
+	xml_printf(&retval, &thread_list, &pos, &size,
+		   "</threads>\n");
+
+	if (retval == ERROR_OK)
+		*thread_list_out = thread_list;
+	else
+		free(thread_list);
+
+	return retval;
+}
+
+static int gdb_get_thread_list_chunk(struct target *target,
+		struct gdb_connection *gdb_connection, char **chunk, int32_t offset,
+		uint32_t length)
 {
+	char **thread_list = &gdb_connection->thread_list;
+
 	if (!*thread_list) {
-		int retval = gdb_generate_thread_list(target, thread_list);
+		int retval;
+		if (gdb_connection->non_stop)
+			retval = gdb_generate_nonstop_thread_list(gdb_connection, thread_list);
+		else
+			retval = gdb_generate_thread_list(target, thread_list);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("Unable to Generate Thread List");
 			return ERROR_FAIL;
@@ -2744,6 +3785,13 @@ static int gdb_query_packet(struct connection *connection,
 	struct command_context *cmd_ctx = connection->cmd_ctx;
 	struct gdb_connection *gdb_connection = connection->priv;
 	struct target *target = get_target_from_connection(connection);
+	char trace_reply[256];
+
+	if (tracepoint_packet(gdb_connection->trace, target, packet, trace_reply,
+			sizeof(trace_reply)) == ERROR_OK) {
+		gdb_put_packet(connection, trace_reply, strlen(trace_reply));
+		return ERROR_OK;
+	}
 
 	if (strncmp(packet, "qRcmd,", 6) == 0) {
 		if (packet_size > 6) {
@@ -2841,7 +3889,9 @@ static int gdb_query_packet(struct connection *connection,
 			len = strtoul(separator + 1, NULL, 16);
 
 			gdb_connection->output_flag = GDB_OUTPUT_NOTIF;
-			retval = target_checksum_memory(target, addr, len, &checksum);
+			retval = flash_cache_checksum(target, addr, len, &checksum);
+			if (retval != ERROR_OK)
+				retval = target_checksum_memory(target, addr, len, &checksum);
 			gdb_connection->output_flag = GDB_OUTPUT_NO;
 
 			if (retval == ERROR_OK) {
@@ -2882,7 +3932,7 @@ static int gdb_query_packet(struct connection *connection,
 			&buffer,
 			&pos,
 			&size,
-			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;qXfer:threads:read+;QStartNoAckMode+;vContSupported+",
+			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;qXfer:threads:read+;QStartNoAckMode+;vContSupported+;ConditionalBreakpoints+;ConditionalTracepoints+;QNonStop+",
 			GDB_BUFFER_SIZE,
 			(gdb_use_memory_map && (flash_get_bank_count() > 0)) ? '+' : '-',
 			gdb_target_desc_supported ? '+' : '-');
@@ -2919,8 +3969,7 @@ static int gdb_query_packet(struct connection *connection,
 		 * there are *more* chunks to transfer. 'l' for it is the *last*
 		 * chunk of target description.
 		 */
-		retval = gdb_get_target_description_chunk(target, &gdb_connection->target_desc,
-				&xml, offset, length);
+		retval = gdb_get_target_description_chunk(target, &xml, offset, length);
 		if (retval != ERROR_OK) {
 			gdb_error(connection, retval);
 			return retval;
@@ -2950,8 +3999,8 @@ static int gdb_query_packet(struct connection *connection,
 		 * there are *more* chunks to transfer. 'l' for it is the *last*
 		 * chunk of target description.
 		 */
-		retval = gdb_get_thread_list_chunk(target, &gdb_connection->thread_list,
-						   &xml, offset, length);
+		retval = gdb_get_thread_list_chunk(target, gdb_connection, &xml, offset,
+				length);
 		if (retval != ERROR_OK) {
 			gdb_error(connection, retval);
 			return retval;
@@ -2965,6 +4014,15 @@ static int gdb_query_packet(struct connection *connection,
 		gdb_connection->noack_mode = 1;
 		gdb_put_packet(connection, "OK", 2);
 		return ERROR_OK;
+	} else if (strncmp(packet, "QNonStop:", 9) == 0) {
+		if (packet[9] == '1' && gdb_nonstop_start(connection) != ERROR_OK) {
+			gdb_send_error(connection, 01);
+			return ERROR_OK;
+		}
+		if (packet[9] == '0')
+			gdb_nonstop_stop(connection);
+		gdb_put_packet(connection, "OK", 2);
+		return ERROR_OK;
 	} else if (target->type->gdb_query_custom) {
 		char *buffer = NULL;
 		int ret = target->type->gdb_query_custom(target, packet, &buffer);
@@ -3242,6 +4300,105 @@ static bool gdb_handle_vrun_packet(struct connection *connection, const char *pa
 	return true;
 }
 
+/* Amount of vFlash data in complete sectors which is written to flash at
+ * once, before the vFlashDone packet */
+#define GDB_VFLASH_WRITE_SIZE	(64 * 1024)
+
+/*
+ * Write the vFlash data which lies in complete flash sectors as soon as
+ * there is enough of it, instead of waiting for the vFlashDone packet.
+ * GDB sends the image in ascending address order, so only the sector
+ * holding the end of the data can still receive more data; it is kept
+ * with the following ones in the image for the next call or vFlashDone.
+ * This bounds the memory used and spreads the programming over the load.
+ */
+static int gdb_vflash_write_complete_sectors(struct connection *connection)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+	struct target *target = get_target_from_connection(connection);
+	struct image *image = gdb_connection->vflash_image;
+	struct imagesection *last = &image->sections[image->num_sections - 1];
+	target_addr_t end = last->base_address + last->size;
+	struct flash_bank *bank;
+
+	if (!last->size)
+		return ERROR_OK;
+
+	int retval = get_flash_bank_by_addr(target, end - 1, false, &bank);
+	if (retval != ERROR_OK || !bank)
+		return retval;
+
+	/* start of the sector holding the end of the data */
+	target_addr_t boundary = bank->base + bank->size;
+	for (unsigned int i = 0; i < bank->num_sectors; i++) {
+		if (end < bank->base + bank->sectors[i].offset + bank->sectors[i].size) {
+			boundary = bank->base + bank->sectors[i].offset;
+			break;
+		}
+	}
+
+	uint32_t complete = 0;
+	for (unsigned int i = 0; i < image->num_sections; i++) {
+		struct imagesection *section = &image->sections[i];
+		if (section->base_address < boundary)
+			complete += MIN(section->base_address + section->size, boundary)
+				- section->base_address;
+	}
+	if (complete < GDB_VFLASH_WRITE_SIZE)
+		return ERROR_OK;
+
+	/* split the image at the boundary */
+	struct image head, *tail = malloc(sizeof(*tail));
+	if (!tail)
+		return ERROR_FAIL;
+	image_open(&head, "", "build");
+	image_open(tail, "", "build");
+
+	for (unsigned int i = 0; i < image->num_sections && retval == ERROR_OK; i++) {
+		struct imagesection *section = &image->sections[i];
+		uint8_t *data = malloc(section->size);
+		size_t size_read;
+		if (!data) {
+			retval = ERROR_FAIL;
+			break;
+		}
+
+		retval = image_read_section(image, i, 0, section->size, data, &size_read);
+		if (retval == ERROR_OK) {
+			uint32_t head_size = 0;
+			if (section->base_address < boundary)
+				head_size = MIN(section->base_address + section->size, boundary)
+					- section->base_address;
+			if (head_size)
+				retval = image_add_section(&head, section->base_address,
+					head_size, section->flags, data);
+			if (retval == ERROR_OK && head_size < section->size)
+				retval = image_add_section(tail, section->base_address + head_size,
+					section->size - head_size, section->flags, data + head_size);
+		}
+		free(data);
+	}
+
+	if (retval == ERROR_OK) {
+		uint32_t written;
+
+		if (!gdb_connection->vflash_started) {
+			target_call_event_callbacks(target, TARGET_EVENT_GDB_FLASH_WRITE_START);
+			gdb_connection->vflash_started = true;
+		}
+		retval = flash_write(target, &head, &written, false);
+		if (retval == ERROR_OK)
+			gdb_connection->vflash_written += written;
+	}
+
+	image_close(&head);
+	image_close(image);
+	free(image);
+	gdb_connection->vflash_image = tail;
+
+	return retval;
+}
+
 static int gdb_v_packet(struct connection *connection,
 		char const *packet, int packet_size)
 {
@@ -3250,6 +4407,15 @@ static int gdb_v_packet(struct connection *connection,
 
 	struct target *target = get_target_from_connection(connection);
 
+	if (gdb_connection->non_stop) {
+		if (strcmp(packet, "vCont?") == 0)
+			return gdb_put_packet(connection, "vCont;c;C;s;S;t", 15);
+		if (strncmp(packet, "vCont;", 6) == 0)
+			return gdb_nonstop_vcont_packet(connection, packet);
+		if (strcmp(packet, "vStopped") == 0)
+			return gdb_nonstop_stopped_packet(connection);
+	}
+
 	if (strncmp(packet, "vCont", 5) == 0) {
 		bool handled;
 
@@ -3366,6 +4532,21 @@ static int gdb_v_packet(struct connection *connection,
 		if (retval != ERROR_OK)
 			return retval;
 
+		retval = gdb_vflash_write_complete_sectors(connection);
+		if (retval != ERROR_OK) {
+			if (gdb_connection->vflash_started)
+				target_call_event_callbacks(target,
+					TARGET_EVENT_GDB_FLASH_WRITE_END);
+			gdb_connection->vflash_started = false;
+			gdb_connection->vflash_written = 0;
+			image_close(gdb_connection->vflash_image);
+			free(gdb_connection->vflash_image);
+			gdb_connection->vflash_image = NULL;
+
+			gdb_send_error(connection, EIO);
+			return ERROR_OK;
+		}
+
 		gdb_put_packet(connection, "OK", 2);
 
 		return ERROR_OK;
@@ -3381,14 +4562,18 @@ static int gdb_v_packet(struct connection *connection,
 			return ERROR_OK;
 		}
 
-		/* process the flashing buffer. No need to erase as GDB
-		 * always issues a vFlashErase first. */
-		target_call_event_callbacks(target,
-				TARGET_EVENT_GDB_FLASH_WRITE_START);
+		/* process the rest of the flashing buffer. No need to erase
+		 * as GDB always issues a vFlashErase first. */
+		if (!gdb_connection->vflash_started)
+			target_call_event_callbacks(target,
+					TARGET_EVENT_GDB_FLASH_WRITE_START);
 		result = flash_write(target, gdb_connection->vflash_image,
 			&written, false);
 		target_call_event_callbacks(target,
 			TARGET_EVENT_GDB_FLASH_WRITE_END);
+		written += gdb_connection->vflash_written;
+		gdb_connection->vflash_started = false;
+		gdb_connection->vflash_written = 0;
 		if (result != ERROR_OK) {
 			if (result == ERROR_FLASH_DST_OUT_OF_BANK)
 				gdb_put_packet(connection, "E.memtype", 9);
@@ -3532,17 +4717,27 @@ static int gdb_input_inner(struct connection *connection)
 
 			gdb_log_incoming_packet(connection, gdb_packet_buffer);
 
+			struct stats_histogram *packet_stats = &stats_gdb_packets[packet[0] & 0x7f];
+			struct duration packet_time;
+			duration_start(&packet_time);
+
 			retval = ERROR_OK;
 			switch (packet[0]) {
 				case 'T':	/* Is thread alive? */
+					if (gdb_con->non_stop && gdb_nonstop_thread_packet(connection, packet))
+						break;
 					gdb_thread_packet(connection, packet, packet_size);
 					break;
 				case 'H':	/* Set current thread ( 'c' for step and continue,
 							 * 'g' for all other operations ) */
+					if (gdb_con->non_stop && gdb_nonstop_thread_packet(connection, packet))
+						break;
 					gdb_thread_packet(connection, packet, packet_size);
 					break;
 				case 'q':
 				case 'Q':
+					if (gdb_con->non_stop && gdb_nonstop_thread_packet(connection, packet))
+						break;
 					retval = gdb_thread_packet(connection, packet, packet_size);
 					if (retval == GDB_THREAD_PACKET_NOT_CONSUMED)
 						retval = gdb_query_packet(connection, packet, packet_size);
@@ -3574,7 +4769,10 @@ static int gdb_input_inner(struct connection *connection)
 					retval = gdb_breakpoint_watchpoint_packet(connection, packet, packet_size);
 					break;
 				case '?':
-					gdb_last_signal_packet(connection, packet, packet_size);
+					if (gdb_con->non_stop)
+						gdb_nonstop_status_packet(connection);
+					else
+						gdb_last_signal_packet(connection, packet, packet_size);
 					/* '?' is sent after the eventual '!' */
 					if (!warn_use_ext && !gdb_con->extended_protocol) {
 						warn_use_ext = true;
@@ -3714,6 +4912,10 @@ static int gdb_input_inner(struct connection *connection)
 					break;
 			}
 
+			if (duration_measure(&packet_time) == ERROR_OK)
+				stats_histogram_add(packet_stats,
+					(uint64_t)(duration_elapsed(&packet_time) * 1000000));
+
 			/* if a packet handler returned an error, exit input loop */
 			if (retval != ERROR_OK)
 				return retval;
@@ -4156,6 +5358,15 @@ int gdb_register_commands(struct command_context *cmd_ctx)
 
 void gdb_service_free(void)
 {
+	while (gdb_target_caches) {
+		struct gdb_target_cache *cache = gdb_target_caches;
+		gdb_target_caches = cache->next;
+		free(cache->tdesc);
+		free(cache->memory_map);
+		gdb_mem_cache_clear(cache);
+		free(cache);
+	}
+
 	free(gdb_port);
 	free(gdb_port_next);
 }
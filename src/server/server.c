@@ -16,6 +16,7 @@
 #endif
 
 #include "server.h"
+#include <helper/stats.h>
 #include <helper/time_support.h>
 #include <target/target.h>
 #include <target/target_request.h>
@@ -474,6 +475,9 @@ int server_loop(struct command_context *command_context)
 			tv.tv_usec = 0;
 			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
 		} else {
+			/* Going idle, let the buffered debug log out first */
+			log_flush();
+
 			/* Timeout socket_select() when a target timer expires or every polling_period */
 			int timeout_ms = next_event - timeval_ms();
 			if (timeout_ms < 0)
@@ -608,6 +612,18 @@ static void sig_handler(int sig)
 		LOG_DEBUG("Terminating on Signal %d", sig);
 	} else
 		LOG_DEBUG("Ignored extra Signal %d", sig);
+
+	/* abort() and failed assertions end the process right after this */
+	if (sig == SIGABRT)
+		log_flush();
+}
+
+static void fatal_sig_handler(int sig)
+{
+	/* write out buffered debug output before crashing */
+	log_flush();
+	signal(sig, SIG_DFL);
+	raise(sig);
 }
 
 
@@ -674,6 +690,12 @@ int server_preinit(void)
 #endif
 	signal(SIGTERM, sig_handler);
 	signal(SIGABRT, sig_handler);
+	signal(SIGSEGV, fatal_sig_handler);
+	signal(SIGILL, fatal_sig_handler);
+	signal(SIGFPE, fatal_sig_handler);
+#ifdef SIGBUS
+	signal(SIGBUS, fatal_sig_handler);
+#endif
 
 	return ERROR_OK;
 }
@@ -801,6 +823,35 @@ COMMAND_HANDLER(handle_bindto_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_stats_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "reset"))
+			return ERROR_COMMAND_SYNTAX_ERROR;
+
+		stats_reset();
+		for (struct target *target = all_targets; target; target = target->next) {
+			target->stats_bytes_read = 0;
+			target->stats_bytes_written = 0;
+		}
+		return ERROR_OK;
+	}
+
+	stats_print(CMD);
+
+	for (struct target *target = all_targets; target; target = target->next) {
+		command_print(CMD, "target.%s.bytes_read %" PRIu64,
+			target_name(target), target->stats_bytes_read);
+		command_print(CMD, "target.%s.bytes_written %" PRIu64,
+			target_name(target), target->stats_bytes_written);
+	}
+
+	return ERROR_OK;
+}
+
 static const struct command_registration server_command_handlers[] = {
 	{
 		.name = "shutdown",
@@ -824,6 +875,13 @@ static const struct command_registration server_command_handlers[] = {
 		.help = "Specify address by name on which to listen for "
 			"incoming TCP/IP connections",
 	},
+	{
+		.name = "stats",
+		.handler = &handle_stats_command,
+		.mode = COMMAND_ANY,
+		.usage = "['reset']",
+		.help = "print or reset the debug link and server counters",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
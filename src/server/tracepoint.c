@@ -0,0 +1,932 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * GDB tracepoints.
+ *
+ * A tracepoint is a breakpoint at which data is collected instead of
+ * stopping: when the target halts on it, the registers and memory ranges
+ * requested by GDB are read into a host side trace buffer, one frame per
+ * hit, and the target is resumed at once. GDB later selects the frames with
+ * "tfind", and reads their registers and memory through the usual packets.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "tracepoint.h"
+#include "agent_expr.h"
+#include <helper/binarybuffer.h>
+#include <helper/bits.h>
+#include <helper/log.h>
+#include <target/breakpoints.h>
+#include <target/register.h>
+#include <target/target.h>
+
+#define TRACEPOINT_BUFFER_SIZE	(1024 * 1024)
+
+/* a memory range to collect, relative to a register or absolute */
+struct tracepoint_mem {
+	int basereg;
+	uint64_t offset;
+	uint32_t length;
+};
+
+struct tracepoint {
+	unsigned int number;
+	target_addr_t address;
+	bool enabled;
+	uint64_t pass;
+	struct agent_expr *condition;
+	/* collected registers, bit n for GDB register n */
+	uint8_t *regmask;
+	unsigned int regmask_size;
+	struct tracepoint_mem *mems;
+	unsigned int num_mems;
+	struct agent_expr **exprs;
+	unsigned int num_exprs;
+	uint64_t hits;
+	uint32_t usage;
+	/* holds a reference on the tracepoint_bp at its address */
+	bool inserted;
+	struct tracepoint *next;
+};
+
+/* breakpoint used by the enabled tracepoints at an address while running */
+struct tracepoint_bp {
+	target_addr_t address;
+	/* number of tracepoints holding the breakpoint */
+	unsigned int refs;
+	/* inserted for the tracepoints, to be removed with the last one */
+	bool owned;
+	/* GDB has its own breakpoint at the same address */
+	bool gdb_breakpoint;
+	struct tracepoint_bp *next;
+};
+
+/*
+ * The data of a frame is a sequence of records, little endian:
+ * 'R' u16 regnum, u16 size, value as in reg->value
+ * 'M' u64 address, u32 length, data
+ */
+struct tracepoint_frame {
+	unsigned int tpnum;
+	target_addr_t address;
+	uint8_t *data;
+	size_t size;
+};
+
+/* breakpoint kind GDB used at an address in a Z0/Z1 packet */
+struct tracepoint_bp_kind {
+	target_addr_t address;
+	unsigned int kind;
+};
+
+/* number of recent GDB breakpoint kinds remembered */
+#define TRACEPOINT_BP_KINDS 32
+
+enum tracepoint_stop_reason {
+	TRACEPOINT_NOT_RUN,
+	TRACEPOINT_RUNNING,
+	TRACEPOINT_STOPPED,
+	TRACEPOINT_FULL,
+	TRACEPOINT_PASSCOUNT,
+};
+
+struct tracepoint_state {
+	struct tracepoint *tracepoints;
+	struct tracepoint_bp *bps;
+	struct target *target;
+
+	bool running;
+	enum tracepoint_stop_reason stop_reason;
+	unsigned int stop_tpnum;
+
+	struct tracepoint_frame *frames;
+	unsigned int num_frames;
+	unsigned int frames_size;
+	size_t buffer_used;
+	int selected;
+
+	/* ring of the kinds of GDB's breakpoints, kept after their removal */
+	struct tracepoint_bp_kind bp_kinds[TRACEPOINT_BP_KINDS];
+	unsigned int bp_kinds_next;
+
+	/* frame being collected */
+	uint8_t *data;
+	size_t size;
+	size_t data_size;
+};
+
+struct tracepoint_state *tracepoint_state_new(void)
+{
+	struct tracepoint_state *state = calloc(1, sizeof(*state));
+	if (state)
+		state->selected = -1;
+
+	return state;
+}
+
+static void tracepoint_free(struct tracepoint *tp)
+{
+	agent_expr_free(tp->condition);
+	for (unsigned int i = 0; i < tp->num_exprs; i++)
+		agent_expr_free(tp->exprs[i]);
+	free(tp->exprs);
+	free(tp->mems);
+	free(tp->regmask);
+	free(tp);
+}
+
+static void tracepoint_clear_frames(struct tracepoint_state *state)
+{
+	for (unsigned int i = 0; i < state->num_frames; i++)
+		free(state->frames[i].data);
+	state->num_frames = 0;
+	state->buffer_used = 0;
+	state->selected = -1;
+}
+
+/* Returns the breakpoint kind GDB last used at @a address, 0 if unknown */
+static unsigned int tracepoint_bp_kind(struct tracepoint_state *state,
+		target_addr_t address)
+{
+	for (unsigned int i = 0; i < TRACEPOINT_BP_KINDS; i++) {
+		const struct tracepoint_bp_kind *k = &state->bp_kinds[i];
+		if (k->kind && k->address == address)
+			return k->kind;
+	}
+
+	return 0;
+}
+
+static struct tracepoint_bp *tracepoint_bp_find(struct tracepoint_state *state,
+		target_addr_t address)
+{
+	for (struct tracepoint_bp *bp = state->bps; bp; bp = bp->next)
+		if (bp->address == address)
+			return bp;
+
+	return NULL;
+}
+
+/* Insert a breakpoint at @a address, or return false */
+static bool tracepoint_bp_add(struct tracepoint_state *state, struct target *target,
+		target_addr_t address)
+{
+	/* hardware comparators don't care much about the instruction size */
+	static const unsigned int hw_lengths[] = { 4, 2 };
+
+	unsigned int kind = tracepoint_bp_kind(state, address);
+	if (kind)
+		return breakpoint_add(target, address, kind, BKPT_HARD) == ERROR_OK
+			|| breakpoint_add(target, address, kind, BKPT_SOFT) == ERROR_OK;
+
+	/* A software breakpoint of the wrong size corrupts the code, so
+	 * without the kind GDB uses there, only hardware ones are tried */
+	for (unsigned int i = 0; i < ARRAY_SIZE(hw_lengths); i++)
+		if (breakpoint_add(target, address, hw_lengths[i], BKPT_HARD) == ERROR_OK)
+			return true;
+
+	LOG_INFO("no hardware breakpoint left; set a GDB breakpoint at the "
+		"tracepoint once so a software breakpoint of the right size can be used");
+	return false;
+}
+
+/* Take a reference on the breakpoint at the address of @a tp, inserting it
+ * for the first tracepoint there unless GDB already has one */
+static int tracepoint_insert(struct tracepoint_state *state, struct target *target,
+		struct tracepoint *tp)
+{
+	if (tp->inserted)
+		return ERROR_OK;
+
+	struct tracepoint_bp *bp = tracepoint_bp_find(state, tp->address);
+	if (!bp) {
+		bp = calloc(1, sizeof(*bp));
+		if (!bp)
+			return ERROR_FAIL;
+		bp->address = tp->address;
+
+		/* no tracepoint uses the address yet, any breakpoint there is GDB's */
+		if (breakpoint_find(target, tp->address)) {
+			bp->gdb_breakpoint = true;
+		} else if (tracepoint_bp_add(state, target, tp->address)) {
+			bp->owned = true;
+		} else {
+			LOG_ERROR("can't insert tracepoint %u at " TARGET_ADDR_FMT,
+				tp->number, tp->address);
+			free(bp);
+			return ERROR_FAIL;
+		}
+
+		bp->next = state->bps;
+		state->bps = bp;
+	}
+
+	bp->refs++;
+	tp->inserted = true;
+	return ERROR_OK;
+}
+
+/* Drop the reference of @a tp, removing the breakpoint with the last one */
+static int tracepoint_remove(struct tracepoint_state *state, struct target *target,
+		struct tracepoint *tp)
+{
+	int retval = ERROR_OK;
+
+	if (!tp->inserted)
+		return ERROR_OK;
+	tp->inserted = false;
+
+	struct tracepoint_bp **pp = &state->bps;
+	while (*pp && (*pp)->address != tp->address)
+		pp = &(*pp)->next;
+	struct tracepoint_bp *bp = *pp;
+	if (!bp || --bp->refs)
+		return ERROR_OK;
+
+	if (bp->owned && !bp->gdb_breakpoint)
+		retval = breakpoint_remove(target, bp->address);
+	*pp = bp->next;
+	free(bp);
+
+	return retval;
+}
+
+static void tracepoint_stop(struct tracepoint_state *state, struct target *target,
+		enum tracepoint_stop_reason reason, unsigned int tpnum)
+{
+	if (!state->running)
+		return;
+
+	for (struct tracepoint *tp = state->tracepoints; tp; tp = tp->next)
+		tracepoint_remove(state, target, tp);
+
+	state->running = false;
+	state->stop_reason = reason;
+	state->stop_tpnum = tpnum;
+}
+
+static int tracepoint_start(struct tracepoint_state *state, struct target *target)
+{
+	tracepoint_stop(state, target, TRACEPOINT_STOPPED, 0);
+	tracepoint_clear_frames(state);
+
+	state->running = true;
+	state->stop_reason = TRACEPOINT_RUNNING;
+
+	for (struct tracepoint *tp = state->tracepoints; tp; tp = tp->next) {
+		tp->hits = 0;
+		tp->usage = 0;
+		if (tp->enabled && tracepoint_insert(state, target, tp) != ERROR_OK) {
+			tracepoint_stop(state, target, TRACEPOINT_STOPPED, 0);
+			return ERROR_FAIL;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+void tracepoint_state_free(struct tracepoint_state *state, struct target *target)
+{
+	if (!state)
+		return;
+
+	tracepoint_stop(state, target, TRACEPOINT_STOPPED, 0);
+	tracepoint_clear_frames(state);
+
+	while (state->tracepoints) {
+		struct tracepoint *tp = state->tracepoints;
+		state->tracepoints = tp->next;
+		tracepoint_free(tp);
+	}
+
+	free(state->frames);
+	free(state->data);
+	free(state);
+}
+
+static struct tracepoint *tracepoint_find(struct tracepoint_state *state,
+		unsigned int number, target_addr_t address)
+{
+	for (struct tracepoint *tp = state->tracepoints; tp; tp = tp->next)
+		if (tp->number == number && tp->address == address)
+			return tp;
+
+	return NULL;
+}
+
+/* Append to the frame being collected */
+static int tracepoint_append(struct tracepoint_state *state, const void *data, size_t size)
+{
+	if (state->size + size > state->data_size) {
+		size_t data_size = state->data_size ? state->data_size : 256;
+		while (data_size < state->size + size)
+			data_size *= 2;
+		uint8_t *p = realloc(state->data, data_size);
+		if (!p)
+			return ERROR_FAIL;
+		state->data = p;
+		state->data_size = data_size;
+	}
+
+	memcpy(state->data + state->size, data, size);
+	state->size += size;
+	return ERROR_OK;
+}
+
+static int tracepoint_collect_memory(void *priv, target_addr_t address,
+		uint32_t size, bool nul_terminated)
+{
+	struct tracepoint_state *state = priv;
+	uint8_t header[13];
+
+	if (state->buffer_used + state->size + sizeof(header) + size > TRACEPOINT_BUFFER_SIZE)
+		return ERROR_BUF_TOO_SMALL;
+
+	uint8_t *buffer = malloc(size);
+	if (!buffer)
+		return ERROR_FAIL;
+
+	/* a single block read per range */
+	int retval = target_read_buffer(state->target, address, size, buffer);
+	if (retval != ERROR_OK) {
+		/* leave the range out of the frame, it reads as unavailable */
+		free(buffer);
+		return ERROR_OK;
+	}
+
+	if (nul_terminated) {
+		uint8_t *nul = memchr(buffer, 0, size);
+		if (nul)
+			size = nul - buffer + 1;
+	}
+
+	header[0] = 'M';
+	h_u64_to_le(header + 1, address);
+	h_u32_to_le(header + 9, size);
+	retval = tracepoint_append(state, header, sizeof(header));
+	if (retval == ERROR_OK)
+		retval = tracepoint_append(state, buffer, size);
+
+	free(buffer);
+	return retval;
+}
+
+static int tracepoint_collect_registers(struct tracepoint_state *state,
+		struct tracepoint *tp)
+{
+	struct target *target = state->target;
+	struct reg **reg_list;
+	int reg_list_size;
+
+	int retval = target_get_gdb_reg_list_noread(target, &reg_list, &reg_list_size,
+			REG_CLASS_ALL);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* the PC is always collected, GDB needs it to show the frame */
+	struct reg *pc = register_get_by_name(target->reg_cache, "pc", true);
+
+	for (int i = 0; i < reg_list_size && retval == ERROR_OK; i++) {
+		struct reg *reg = reg_list[i];
+		bool wanted = (unsigned int)i / 8 < tp->regmask_size
+			&& (tp->regmask[i / 8] & BIT(i % 8));
+		if (!reg || !reg->exist || (!wanted && reg != pc))
+			continue;
+
+		if (!reg->valid && reg->type->get(reg) != ERROR_OK)
+			continue;
+
+		uint8_t header[5];
+		unsigned int size = DIV_ROUND_UP(reg->size, 8);
+		header[0] = 'R';
+		h_u16_to_le(header + 1, i);
+		h_u16_to_le(header + 3, size);
+		retval = tracepoint_append(state, header, sizeof(header));
+		if (retval == ERROR_OK)
+			retval = tracepoint_append(state, reg->value, size);
+	}
+
+	free(reg_list);
+	return retval;
+}
+
+static int tracepoint_collect(struct tracepoint_state *state, struct tracepoint *tp)
+{
+	struct target *target = state->target;
+	uint64_t value;
+	int retval;
+
+	state->size = 0;
+
+	retval = tracepoint_collect_registers(state, tp);
+
+	for (unsigned int i = 0; i < tp->num_mems && retval == ERROR_OK; i++) {
+		struct tracepoint_mem *mem = &tp->mems[i];
+		target_addr_t address = mem->offset;
+
+		if (mem->basereg >= 0) {
+			struct agent_expr reg_expr;
+			uint8_t bytes[] = { 0x26, mem->basereg >> 8, mem->basereg, 0x27 };
+
+			/* "reg n; end" gives the register as agent expressions see it */
+			reg_expr.length = sizeof(bytes);
+			reg_expr.bytes = bytes;
+			if (agent_expr_eval(target, &reg_expr, NULL, NULL, &value) != ERROR_OK)
+				continue;
+			address += value;
+		}
+
+		retval = tracepoint_collect_memory(state, address, mem->length, false);
+	}
+
+	for (unsigned int i = 0; i < tp->num_exprs && retval == ERROR_OK; i++) {
+		retval = agent_expr_eval(target, tp->exprs[i], tracepoint_collect_memory,
+			state, &value);
+		/* an expression which can't be evaluated just collects less */
+		if (retval != ERROR_BUF_TOO_SMALL)
+			retval = ERROR_OK;
+	}
+
+	if (retval == ERROR_OK
+			&& state->buffer_used + state->size > TRACEPOINT_BUFFER_SIZE)
+		retval = ERROR_BUF_TOO_SMALL;
+
+	if (retval == ERROR_OK && state->num_frames == state->frames_size) {
+		unsigned int frames_size = state->frames_size ? 2 * state->frames_size : 64;
+		struct tracepoint_frame *frames = realloc(state->frames,
+			frames_size * sizeof(*frames));
+		if (!frames)
+			return ERROR_FAIL;
+		state->frames = frames;
+		state->frames_size = frames_size;
+	}
+
+	if (retval != ERROR_OK)
+		return retval;
+
+	struct tracepoint_frame *frame = &state->frames[state->num_frames];
+	frame->data = malloc(state->size);
+	if (!frame->data)
+		return ERROR_FAIL;
+	memcpy(frame->data, state->data, state->size);
+	frame->size = state->size;
+	frame->tpnum = tp->number;
+	frame->address = tp->address;
+	state->num_frames++;
+	state->buffer_used += state->size;
+	tp->usage += state->size;
+
+	return ERROR_OK;
+}
+
+enum tracepoint_hit_result tracepoint_hit(struct tracepoint_state *state,
+		struct target *target)
+{
+	if (!state->running || target->state != TARGET_HALTED
+			|| target->debug_reason != DBG_REASON_BREAKPOINT)
+		return TRACEPOINT_HIT_NONE;
+
+	struct reg *pc = register_get_by_name(target->reg_cache, "pc", true);
+	if (!pc || (!pc->valid && pc->type->get(pc) != ERROR_OK))
+		return TRACEPOINT_HIT_NONE;
+	target_addr_t address = buf_get_u64(pc->value, 0, MIN(pc->size, 64));
+
+	struct tracepoint_bp *bp = tracepoint_bp_find(state, address);
+	if (!bp)
+		return TRACEPOINT_HIT_NONE;
+	enum tracepoint_hit_result result =
+		bp->gdb_breakpoint ? TRACEPOINT_HIT_REPORT : TRACEPOINT_HIT_RESUME;
+
+	state->target = target;
+
+	for (struct tracepoint *tp = state->tracepoints; tp && state->running; tp = tp->next) {
+		if (!tp->inserted || tp->address != address)
+			continue;
+
+		if (tp->condition) {
+			uint64_t value;
+			if (agent_expr_eval(target, tp->condition, NULL, NULL, &value) != ERROR_OK
+					|| !value)
+				continue;
+		}
+
+		int retval = tracepoint_collect(state, tp);
+		if (retval == ERROR_BUF_TOO_SMALL) {
+			LOG_INFO("trace buffer full, trace experiment stopped");
+			tracepoint_stop(state, target, TRACEPOINT_FULL, 0);
+			break;
+		} else if (retval != ERROR_OK) {
+			LOG_ERROR("tracepoint %u: collection failed", tp->number);
+		}
+
+		tp->hits++;
+		if (tp->pass && tp->hits >= tp->pass) {
+			LOG_INFO("tracepoint %u reached its pass count, trace experiment stopped",
+				tp->number);
+			/* still report the stop if GDB has a breakpoint there */
+			tracepoint_stop(state, target, TRACEPOINT_PASSCOUNT, tp->number);
+		}
+	}
+
+	return result;
+}
+
+bool tracepoint_share_breakpoint(struct tracepoint_state *state,
+		target_addr_t address, bool insert)
+{
+	struct tracepoint_bp *bp = tracepoint_bp_find(state, address);
+
+	if (!bp)
+		return false;
+
+	/* the breakpoint stays as long as a tracepoint needs it */
+	bp->gdb_breakpoint = insert;
+	if (!insert)
+		bp->owned = true;
+
+	return true;
+}
+
+void tracepoint_breakpoint_kind(struct tracepoint_state *state,
+		target_addr_t address, unsigned int kind)
+{
+	if (!kind)
+		return;
+
+	for (unsigned int i = 0; i < TRACEPOINT_BP_KINDS; i++) {
+		struct tracepoint_bp_kind *k = &state->bp_kinds[i];
+		if (k->kind && k->address == address) {
+			k->kind = kind;
+			return;
+		}
+	}
+
+	state->bp_kinds[state->bp_kinds_next].address = address;
+	state->bp_kinds[state->bp_kinds_next].kind = kind;
+	state->bp_kinds_next = (state->bp_kinds_next + 1) % TRACEPOINT_BP_KINDS;
+}
+
+bool tracepoint_frame_selected(struct tracepoint_state *state)
+{
+	return state->selected >= 0;
+}
+
+/* Find the record of @a type holding @a key in the selected frame */
+static const uint8_t *tracepoint_frame_find(struct tracepoint_state *state,
+		char type, uint64_t key)
+{
+	struct tracepoint_frame *frame = &state->frames[state->selected];
+	const uint8_t *p = frame->data;
+	const uint8_t *end = frame->data + frame->size;
+
+	while (p < end) {
+		if (p[0] == 'R') {
+			if (type == 'R' && le_to_h_u16(p + 1) == key)
+				return p;
+			p += 5 + le_to_h_u16(p + 3);
+		} else {
+			uint64_t address = le_to_h_u64(p + 1);
+			uint32_t length = le_to_h_u32(p + 9);
+			if (type == 'M' && key >= address && key - address < length)
+				return p;
+			p += 13 + length;
+		}
+	}
+
+	return NULL;
+}
+
+uint32_t tracepoint_frame_read_memory(struct tracepoint_state *state,
+		target_addr_t address, uint32_t size, uint8_t *buffer)
+{
+	uint32_t done = 0;
+
+	while (done < size) {
+		const uint8_t *record = tracepoint_frame_find(state, 'M', address + done);
+		if (!record)
+			break;
+
+		uint64_t offset = address + done - le_to_h_u64(record + 1);
+		uint32_t length = MIN(le_to_h_u32(record + 9) - offset, size - done);
+		memcpy(buffer + done, record + 13 + offset, length);
+		done += length;
+	}
+
+	return done;
+}
+
+const uint8_t *tracepoint_frame_reg(struct tracepoint_state *state,
+		unsigned int regnum)
+{
+	const uint8_t *record = tracepoint_frame_find(state, 'R', regnum);
+
+	return record ? record + 5 : NULL;
+}
+
+/* Parse the actions of a "QTDP:-n:addr:" packet */
+static int tracepoint_parse_actions(struct tracepoint *tp, const char *p)
+{
+	char *end;
+
+	if (*p == 'S') {
+		LOG_WARNING("tracepoint %u: while-stepping actions are not supported", tp->number);
+		return ERROR_OK;
+	}
+
+	while (*p && *p != '-') {
+		switch (*p++) {
+		case 'R': {
+			size_t digits = strspn(p, "0123456789abcdefABCDEF");
+			unsigned int size = DIV_ROUND_UP(digits, 2);
+			if (size > tp->regmask_size) {
+				uint8_t *regmask = realloc(tp->regmask, size);
+				if (!regmask)
+					return ERROR_FAIL;
+				memset(regmask + tp->regmask_size, 0, size - tp->regmask_size);
+				tp->regmask = regmask;
+				tp->regmask_size = size;
+			}
+			/* the last digit holds registers 0 to 3 */
+			for (size_t i = 0; i < digits; i++) {
+				char digit[2] = { p[digits - 1 - i], 0 };
+				tp->regmask[i / 2] |= strtoul(digit, NULL, 16) << (4 * (i % 2));
+			}
+			p += digits;
+			break;
+		}
+		case 'M': {
+			struct tracepoint_mem mem;
+			mem.basereg = (int32_t)strtoul(p, &end, 16);
+			if (*end != ',')
+				return ERROR_FAIL;
+			mem.offset = strtoull(end + 1, &end, 16);
+			if (*end != ',')
+				return ERROR_FAIL;
+			mem.length = strtoul(end + 1, &end, 16);
+			p = end;
+
+			struct tracepoint_mem *mems = realloc(tp->mems,
+				(tp->num_mems + 1) * sizeof(*mems));
+			if (!mems)
+				return ERROR_FAIL;
+			tp->mems = mems;
+			tp->mems[tp->num_mems++] = mem;
+			break;
+		}
+		case 'X': {
+			struct agent_expr *expr;
+			if (agent_expr_parse(p, &p, &expr) != ERROR_OK)
+				return ERROR_FAIL;
+
+			struct agent_expr **exprs = realloc(tp->exprs,
+				(tp->num_exprs + 1) * sizeof(*exprs));
+			if (!exprs) {
+				agent_expr_free(expr);
+				return ERROR_FAIL;
+			}
+			tp->exprs = exprs;
+			tp->exprs[tp->num_exprs++] = expr;
+			break;
+		}
+		default:
+			return ERROR_FAIL;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+/* QTDP:n:addr:E|D:step:pass[:Fflen][:Xlen,expr][-] or QTDP:-n:addr:actions[-] */
+static int tracepoint_define(struct tracepoint_state *state, const char *p)
+{
+	bool actions = *p == '-';
+	char *end;
+
+	if (actions)
+		p++;
+
+	unsigned int number = strtoul(p, &end, 16);
+	if (*end != ':')
+		return ERROR_FAIL;
+	target_addr_t address = strtoull(end + 1, &end, 16);
+	if (*end != ':')
+		return ERROR_FAIL;
+	p = end + 1;
+
+	if (actions) {
+		struct tracepoint *tp = tracepoint_find(state, number, address);
+		if (!tp)
+			return ERROR_FAIL;
+		return tracepoint_parse_actions(tp, p);
+	}
+
+	struct tracepoint *tp = calloc(1, sizeof(*tp));
+	if (!tp)
+		return ERROR_FAIL;
+	tp->number = number;
+	tp->address = address;
+	tp->enabled = *p == 'E';
+
+	uint64_t step = strtoull(p + 2, &end, 16);
+	if (*end != ':') {
+		tracepoint_free(tp);
+		return ERROR_FAIL;
+	}
+	if (step)
+		LOG_WARNING("tracepoint %u: while-stepping is not supported", number);
+	tp->pass = strtoull(end + 1, &end, 16);
+	p = end;
+
+	while (*p == ':') {
+		if (p[1] == 'X' && agent_expr_parse(p + 2, &p, &tp->condition) == ERROR_OK)
+			continue;
+
+		/* fast tracepoints and unknown fields */
+		tracepoint_free(tp);
+		return ERROR_FAIL;
+	}
+
+	/* a definition replaces the previous one */
+	struct tracepoint **pp = &state->tracepoints;
+	while (*pp && !((*pp)->number == number && (*pp)->address == address))
+		pp = &(*pp)->next;
+	if (*pp) {
+		struct tracepoint *old = *pp;
+		tp->next = old->next;
+		tracepoint_free(old);
+	}
+	*pp = tp;
+
+	return ERROR_OK;
+}
+
+/* QTFrame:n, QTFrame:pc:addr, QTFrame:tdp:n, QTFrame:range:start:end,
+ * QTFrame:outside:start:end */
+static void tracepoint_select_frame(struct tracepoint_state *state, const char *p,
+		char *reply, size_t reply_size)
+{
+	uint64_t a = 0, b = 0;
+	enum { BY_NUMBER, BY_PC, BY_TDP, BY_RANGE, BY_OUTSIDE } by = BY_NUMBER;
+	char *end;
+
+	if (strncmp(p, "pc:", 3) == 0) {
+		by = BY_PC;
+		a = strtoull(p + 3, NULL, 16);
+	} else if (strncmp(p, "tdp:", 4) == 0) {
+		by = BY_TDP;
+		a = strtoull(p + 4, NULL, 16);
+	} else if (strncmp(p, "range:", 6) == 0 || strncmp(p, "outside:", 8) == 0) {
+		by = p[0] == 'r' ? BY_RANGE : BY_OUTSIDE;
+		a = strtoull(strchr(p, ':') + 1, &end, 16);
+		if (*end == ':')
+			b = strtoull(end + 1, NULL, 16);
+	} else {
+		int64_t n = (int32_t)strtoul(p, NULL, 16);
+		if (n < 0) {
+			state->selected = -1;
+			snprintf(reply, reply_size, "OK");
+			return;
+		}
+		a = n;
+	}
+
+	int found = -1;
+	if (by == BY_NUMBER) {
+		if (a < state->num_frames)
+			found = a;
+	} else {
+		/* search after the selected frame */
+		for (unsigned int i = state->selected + 1; i < state->num_frames; i++) {
+			struct tracepoint_frame *frame = &state->frames[i];
+			bool match = (by == BY_PC && frame->address == a)
+				|| (by == BY_TDP && frame->tpnum == a)
+				|| (by == BY_RANGE && frame->address >= a && frame->address <= b)
+				|| (by == BY_OUTSIDE && (frame->address < a || frame->address > b));
+			if (match) {
+				found = i;
+				break;
+			}
+		}
+	}
+
+	state->selected = found;
+	if (found < 0)
+		snprintf(reply, reply_size, "F-1");
+	else
+		snprintf(reply, reply_size, "F%xT%x", found, state->frames[found].tpnum);
+}
+
+static const char *tracepoint_stop_reason_name(enum tracepoint_stop_reason reason)
+{
+	switch (reason) {
+	case TRACEPOINT_NOT_RUN:
+		return "tnotrun";
+	case TRACEPOINT_STOPPED:
+		return "tstop";
+	case TRACEPOINT_FULL:
+		return "tfull";
+	case TRACEPOINT_PASSCOUNT:
+		return "tpasscount";
+	default:
+		return "tunknown";
+	}
+}
+
+int tracepoint_packet(struct tracepoint_state *state, struct target *target,
+		const char *packet, char *reply, size_t reply_size)
+{
+	int retval = ERROR_OK;
+
+	if ((packet[0] != 'q' && packet[0] != 'Q') || packet[1] != 'T'
+			|| strncmp(packet, "qThreadExtraInfo", 16) == 0
+			|| strncmp(packet, "qTLSAddr", 8) == 0)
+		return ERROR_NOT_IMPLEMENTED;
+
+	reply[0] = '\0';
+
+	if (strncmp(packet, "QTFrame:", 8) == 0) {
+		tracepoint_select_frame(state, packet + 8, reply, reply_size);
+		return ERROR_OK;
+	}
+
+	if (strcmp(packet, "qTStatus") == 0) {
+		snprintf(reply, reply_size,
+			"T%d;%s:%x;tframes:%x;tcreated:%x;tfree:%zx;tsize:%x;circular:0;disconn:0",
+			state->running ? 1 : 0, tracepoint_stop_reason_name(state->stop_reason),
+			state->stop_tpnum, state->num_frames, state->num_frames,
+			TRACEPOINT_BUFFER_SIZE - state->buffer_used, TRACEPOINT_BUFFER_SIZE);
+		return ERROR_OK;
+	}
+
+	if (strncmp(packet, "qTP:", 4) == 0) {
+		char *end;
+		unsigned int number = strtoul(packet + 4, &end, 16);
+		target_addr_t address = (*end == ':') ? strtoull(end + 1, NULL, 16) : 0;
+		struct tracepoint *tp = tracepoint_find(state, number, address);
+		if (tp)
+			snprintf(reply, reply_size, "V%" PRIx64 ":%" PRIx32, tp->hits, tp->usage);
+		return ERROR_OK;
+	}
+
+	if (strcmp(packet, "qTfP") == 0 || strcmp(packet, "qTsP") == 0
+			|| strcmp(packet, "qTfV") == 0 || strcmp(packet, "qTsV") == 0) {
+		/* definitions are not uploaded back to GDB */
+		snprintf(reply, reply_size, "l");
+		return ERROR_OK;
+	}
+
+	if (strcmp(packet, "QTinit") == 0) {
+		tracepoint_stop(state, target, TRACEPOINT_STOPPED, 0);
+		tracepoint_clear_frames(state);
+		while (state->tracepoints) {
+			struct tracepoint *tp = state->tracepoints;
+			state->tracepoints = tp->next;
+			tracepoint_free(tp);
+		}
+		state->stop_reason = TRACEPOINT_NOT_RUN;
+	} else if (strncmp(packet, "QTDP:", 5) == 0) {
+		if (state->running)
+			retval = ERROR_FAIL;
+		else
+			retval = tracepoint_define(state, packet + 5);
+	} else if (strncmp(packet, "QTDPsrc:", 8) == 0 || strncmp(packet, "QTDV:", 5) == 0
+			|| strncmp(packet, "QTro", 4) == 0
+			|| strcmp(packet, "QTBuffer:circular:0") == 0) {
+		/* nothing to do */
+	} else if (strcmp(packet, "QTStart") == 0) {
+		if (target->state != TARGET_HALTED)
+			retval = ERROR_TARGET_NOT_HALTED;
+		else
+			retval = tracepoint_start(state, target);
+	} else if (strcmp(packet, "QTStop") == 0) {
+		tracepoint_stop(state, target, TRACEPOINT_STOPPED, 0);
+	} else if (strncmp(packet, "QTEnable:", 9) == 0 || strncmp(packet, "QTDisable:", 10) == 0) {
+		bool enable = packet[2] == 'E';
+		char *end;
+		unsigned int number = strtoul(strchr(packet, ':') + 1, &end, 16);
+		target_addr_t address = (*end == ':') ? strtoull(end + 1, NULL, 16) : 0;
+		struct tracepoint *tp = tracepoint_find(state, number, address);
+		if (!tp) {
+			retval = ERROR_FAIL;
+		} else if (state->running && enable) {
+			retval = tracepoint_insert(state, target, tp);
+		} else if (state->running) {
+			retval = tracepoint_remove(state, target, tp);
+		}
+		if (tp && retval == ERROR_OK)
+			tp->enabled = enable;
+	} else {
+		/* unsupported, like trace state variables or fast tracepoints */
+		return ERROR_OK;
+	}
+
+	if (retval == ERROR_OK)
+		snprintf(reply, reply_size, "OK");
+	else
+		snprintf(reply, reply_size, "E01");
+
+	return ERROR_OK;
+}
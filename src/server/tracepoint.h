@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_SERVER_TRACEPOINT_H
+#define OPENOCD_SERVER_TRACEPOINT_H
+
+#include <helper/types.h>
+
+struct target;
+
+/** Tracepoints, trace experiment and trace buffer of a GDB connection */
+struct tracepoint_state;
+
+enum tracepoint_hit_result {
+	/* the target did not halt on a tracepoint */
+	TRACEPOINT_HIT_NONE,
+	/* data was collected, the target can be resumed */
+	TRACEPOINT_HIT_RESUME,
+	/* data was collected, GDB has a breakpoint at the same address */
+	TRACEPOINT_HIT_REPORT,
+};
+
+struct tracepoint_state *tracepoint_state_new(void);
+void tracepoint_state_free(struct tracepoint_state *state, struct target *target);
+
+/**
+ * Handle a tracepoint packet (qT... or QT...).
+ * @param state tracepoint state of the connection.
+ * @param target the target of the connection.
+ * @param packet the packet, null terminated.
+ * @param reply buffer for the reply, possibly empty.
+ * @param reply_size size of @a reply.
+ * @returns ERROR_OK if the packet was handled, ERROR_NOT_IMPLEMENTED if it
+ *	is not a tracepoint packet.
+ */
+int tracepoint_packet(struct tracepoint_state *state, struct target *target,
+		const char *packet, char *reply, size_t reply_size);
+
+/** Collect the data of the tracepoints at the PC of the halted @a target */
+enum tracepoint_hit_result tracepoint_hit(struct tracepoint_state *state,
+		struct target *target);
+
+/**
+ * Tell that GDB inserts (@a insert true) or removes its own breakpoint at
+ * @a address. Returns true if a running tracepoint owns a breakpoint there,
+ * which must then be left as is.
+ */
+bool tracepoint_share_breakpoint(struct tracepoint_state *state,
+		target_addr_t address, bool insert);
+
+/**
+ * Remember the breakpoint @a kind of a Z0/Z1 packet at @a address, so a
+ * tracepoint there can use a software breakpoint of the same size.
+ */
+void tracepoint_breakpoint_kind(struct tracepoint_state *state,
+		target_addr_t address, unsigned int kind);
+
+/** Returns true while GDB looks at a trace frame instead of the target */
+bool tracepoint_frame_selected(struct tracepoint_state *state);
+
+/**
+ * Read memory from the selected trace frame.
+ * @returns the number of bytes from @a address on collected in the frame.
+ */
+uint32_t tracepoint_frame_read_memory(struct tracepoint_state *state,
+		target_addr_t address, uint32_t size, uint8_t *buffer);
+
+/**
+ * Returns the value of GDB register @a regnum in the selected trace frame,
+ * in the format of reg->value, or NULL if it was not collected.
+ */
+const uint8_t *tracepoint_frame_reg(struct tracepoint_state *state,
+		unsigned int regnum);
+
+#endif /* OPENOCD_SERVER_TRACEPOINT_H */
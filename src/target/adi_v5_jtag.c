@@ -28,6 +28,7 @@
 #include "arm.h"
 #include "arm_adi_v5.h"
 #include <helper/time_support.h>
+#include <helper/stats.h>
 #include <helper/list.h>
 #include <jtag/swd.h>
 
@@ -448,6 +449,8 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 		if (el->ack == JTAG_ACK_OK_FAULT || (is_adiv6(dap) && el->ack == JTAG_ACK_OK)) {
 			log_dap_cmd(dap, "LOG", el);
 		} else if (el->ack == JTAG_ACK_WAIT) {
+			stats_add(STATS_DAP_WAITS, 1);
+			dap->waits++;
 			found_wait = 1;
 			break;
 		} else {
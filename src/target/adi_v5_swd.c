@@ -37,11 +37,13 @@
 #include "arm.h"
 #include "arm_adi_v5.h"
 #include <helper/time_support.h>
+#include <helper/stats.h>
 
 #include <transport/transport.h>
 #include <jtag/interface.h>
 
 #include <jtag/swd.h>
+#include <jtag/swd_trace.h>
 
 /* for debug, set do_sync to true to force synchronous transfers */
 static bool do_sync;
@@ -67,6 +69,7 @@ static void swd_finish_read(struct adiv5_dap *dap)
 {
 	const struct swd_driver *swd = adiv5_dap_swd_driver(dap);
 	if (dap->last_read) {
+		stats_add(STATS_SWD_TRANSACTIONS, 1);
 		swd->read_reg(swd_cmd(true, false, DP_RDBUFF), dap->last_read, 0);
 		dap->last_read = NULL;
 	}
@@ -77,15 +80,27 @@ static void swd_clear_sticky_errors(struct adiv5_dap *dap)
 	const struct swd_driver *swd = adiv5_dap_swd_driver(dap);
 	assert(swd);
 
+	stats_add(STATS_SWD_TRANSACTIONS, 1);
 	swd->write_reg(swd_cmd(false, false, DP_ABORT),
 		STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR, 0);
 }
 
+/* swd_wait_count() as of the last run, to attribute new WAITs to a DAP */
+static unsigned int swd_waits_seen;
+
 static int swd_run_inner(struct adiv5_dap *dap)
 {
 	const struct swd_driver *swd = adiv5_dap_swd_driver(dap);
 
-	return swd->run();
+	int retval = swd->run();
+	stats_add(STATS_SWD_FLUSHES, 1);
+
+	/* Some drivers transfer while queueing, so count since the last run */
+	unsigned int waits = swd_wait_count();
+	dap->waits += waits - swd_waits_seen;
+	swd_waits_seen = waits;
+
+	return retval;
 }
 
 static inline int check_sync(struct adiv5_dap *dap)
@@ -129,6 +144,7 @@ static int swd_queue_dp_read_inner(struct adiv5_dap *dap, unsigned int reg,
 	if (retval != ERROR_OK)
 		return retval;
 
+	stats_add(STATS_SWD_TRANSACTIONS, 1);
 	swd->read_reg(swd_cmd(true, false, reg), data, 0);
 
 	return check_sync(dap);
@@ -146,6 +162,7 @@ static int swd_queue_dp_write_inner(struct adiv5_dap *dap, unsigned int reg,
 	if (reg == DP_SELECT) {
 		dap->select = data | (dap->select & (0xffffffffull << 32));
 
+		stats_add(STATS_SWD_TRANSACTIONS, 1);
 		swd->write_reg(swd_cmd(false, false, reg), data, 0);
 
 		retval = check_sync(dap);
@@ -164,6 +181,7 @@ static int swd_queue_dp_write_inner(struct adiv5_dap *dap, unsigned int reg,
 		retval = swd_queue_dp_bankselect(dap, reg);
 
 	if (retval == ERROR_OK) {
+		stats_add(STATS_SWD_TRANSACTIONS, 1);
 		swd->write_reg(swd_cmd(false, false, reg), data, 0);
 
 		retval = check_sync(dap);
@@ -480,6 +498,7 @@ static int swd_queue_ap_abort(struct adiv5_dap *dap, uint8_t *ack)
 	if (retval != ERROR_OK)
 		return retval;
 
+	stats_add(STATS_SWD_TRANSACTIONS, 1);
 	swd->write_reg(swd_cmd(false, false, DP_ABORT),
 		DAPABORT | STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR, 0);
 	return check_sync(dap);
@@ -586,6 +605,7 @@ static int swd_queue_ap_read(struct adiv5_ap *ap, unsigned int reg,
 	if (retval != ERROR_OK)
 		return retval;
 
+	stats_add(STATS_SWD_TRANSACTIONS, 1);
 	swd->read_reg(swd_cmd(true, true, reg), dap->last_read, ap->memaccess_tck);
 	dap->last_read = data;
 
@@ -613,6 +633,7 @@ static int swd_queue_ap_write(struct adiv5_ap *ap, unsigned int reg,
 	if (retval != ERROR_OK)
 		return retval;
 
+	stats_add(STATS_SWD_TRANSACTIONS, 1);
 	swd->write_reg(swd_cmd(false, true, reg), data, ap->memaccess_tck);
 
 	return check_sync(dap);
@@ -687,6 +708,25 @@ const struct dap_ops swd_dap_ops = {
 	.quit = swd_quit,
 };
 
+COMMAND_HANDLER(handle_swd_record_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!strcmp(CMD_ARGV[0], "off")) {
+		swd_trace_record_stop();
+		return ERROR_OK;
+	}
+
+	/* The SWD driver is wrapped for recording when the DAPs are set up */
+	if (CMD_CTX->mode == COMMAND_EXEC) {
+		command_print(CMD, "recording must be started before 'init'");
+		return ERROR_FAIL;
+	}
+
+	return swd_trace_record_start(CMD_ARGV[0]);
+}
+
 static const struct command_registration swd_commands[] = {
 	{
 		/*
@@ -709,6 +749,14 @@ static const struct command_registration swd_commands[] = {
 			"['-ir-bypass' number] "
 			"['-mask' number]",
 	},
+	{
+		.name = "record",
+		.handler = handle_swd_record_command,
+		.mode = COMMAND_ANY,
+		.help = "record the SWD transactions of the session into a file, "
+			"for playback with the swd_replay adapter",
+		.usage = "filename|'off'",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
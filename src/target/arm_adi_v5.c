@@ -458,6 +458,60 @@ static int mem_ap_setup_transfer_verify_size_packing_fallback(struct adiv5_ap *a
 	return retval;
 }
 
+/* Automatic memaccess_tck: initial raise on WAIT, and bounds of the number
+ * of clean transfers awaited before trying a shorter delay */
+#define MEMACCESS_TCK_AUTO_STEP			8
+#define MEMACCESS_TCK_AUTO_CLEAN_MIN	32
+#define MEMACCESS_TCK_AUTO_CLEAN_MAX	4096
+
+/**
+ * Account a MEM-AP transfer and, if enabled, adapt the idle cycles after
+ * each AP access to the bus speed of the target.
+ *
+ * A transfer that met WAIT responses doubles memaccess_tck, and doubles the
+ * number of clean transfers needed before it is halved again. This keeps the
+ * delay close to the shortest one the target accepts without oscillating.
+ *
+ * @param ap The MEM-AP.
+ * @param waits WAIT responses seen during the transfer, including retried ones.
+ * @param retval Result of the transfer.
+ */
+static void mem_ap_tune(struct adiv5_ap *ap, unsigned int waits, int retval)
+{
+	bool waited = waits || retval == ERROR_WAIT;
+
+	ap->transfers++;
+	if (waited)
+		ap->transfers_waited++;
+	if (retval != ERROR_OK)
+		ap->transfers_failed++;
+
+	if (!ap->memaccess_tck_auto)
+		return;
+
+	if (!ap->memaccess_clean_needed)
+		ap->memaccess_clean_needed = MEMACCESS_TCK_AUTO_CLEAN_MIN;
+
+	uint32_t memaccess_tck = ap->memaccess_tck;
+	if (waited) {
+		memaccess_tck = MIN(MAX(2 * memaccess_tck, MEMACCESS_TCK_AUTO_STEP), 255);
+		ap->memaccess_clean_needed = MIN(2 * ap->memaccess_clean_needed,
+			MEMACCESS_TCK_AUTO_CLEAN_MAX);
+		ap->memaccess_clean_transfers = 0;
+	} else if (retval == ERROR_OK && memaccess_tck) {
+		if (++ap->memaccess_clean_transfers >= ap->memaccess_clean_needed) {
+			memaccess_tck /= 2;
+			ap->memaccess_clean_transfers = 0;
+		}
+	}
+
+	if (memaccess_tck != ap->memaccess_tck) {
+		LOG_DEBUG("AP#0x%" PRIx64 " memory access delay %" PRIu32 " -> %" PRIu32 " tck",
+			ap->ap_num, ap->memaccess_tck, memaccess_tck);
+		ap->memaccess_tck = memaccess_tck;
+	}
+}
+
 /**
  * Synchronous write of a block of memory, using a specific access size.
  *
@@ -512,6 +566,8 @@ static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t siz
 	if (ap->unaligned_access_bad && (address % size != 0))
 		return ERROR_TARGET_UNALIGNED_ACCESS;
 
+	unsigned int waits = dap->waits;
+
 	/* Nuvoton NPCX quirks prevent packed writes */
 	bool pack = !dap->nu_npcx_quirks;
 
@@ -585,6 +641,8 @@ static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t siz
 			LOG_ERROR("Failed to write memory and, additionally, failed to find out where");
 	}
 
+	mem_ap_tune(ap, dap->waits - waits, retval);
+
 	return retval;
 }
 
@@ -636,6 +694,8 @@ static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint
 		return ERROR_FAIL;
 	}
 
+	unsigned int waits = dap->waits;
+
 	/* Queue up all reads. Each read will store the entire DRW word in the read buffer. How many
 	 * useful bytes it contains, and their location in the word, depends on the type of transfer
 	 * and alignment. */
@@ -665,6 +725,8 @@ static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint
 	if (retval == ERROR_OK)
 		retval = dap_run(dap);
 
+	mem_ap_tune(ap, dap->waits - waits, retval);
+
 	/* Restore state */
 	address = adr;
 	nbytes = size * count;
@@ -1220,6 +1282,7 @@ int dap_put_ap(struct adiv5_ap *ap)
 		/* defaults from dap_instance_init() */
 		ap->ap_num = DP_APSEL_INVALID;
 		ap->memaccess_tck = 255;
+		ap->memaccess_tck_auto = false;
 		ap->tar_autoincr_block = (1 << 10);
 		ap->csw_default = CSW_AHB_DEFAULT;
 		ap->cfg_reg = MEM_AP_REG_CFG_INVALID;
@@ -2107,6 +2170,17 @@ static int dap_info_mem_ap_header(int retval, struct adiv5_ap *ap,
 			else
 				command_print(cmd, "\t\tROM table in legacy format");
 		}
+
+		if (!depth) {
+			command_print(cmd, "\t\tMemory access delay %" PRIu32 " tck%s",
+				ap->memaccess_tck, ap->memaccess_tck_auto ? " (automatic)" : "");
+			command_print(cmd, "\t\tTAR autoincrement block %" PRIu32 " bytes, packed transfers %s",
+				ap->tar_autoincr_block,
+				!ap->packed_transfers_probed ? "not probed" :
+				ap->packed_transfers_supported ? "supported" : "not supported");
+			command_print(cmd, "\t\t%" PRIu64 " transfers, %" PRIu64 " with WAIT, %" PRIu64 " failed",
+				ap->transfers, ap->transfers_waited, ap->transfers_failed);
+		}
 	}
 
 	return ERROR_OK;
@@ -2633,17 +2707,26 @@ COMMAND_HANDLER(dap_memaccess_command)
 			command_print(CMD, "Cannot get AP");
 			return ERROR_FAIL;
 		}
+		if (!strcmp(CMD_ARGV[0], "auto")) {
+			ap->memaccess_tck_auto = true;
+			ap->memaccess_clean_transfers = 0;
+			ap->memaccess_clean_needed = 0;
+			memaccess_tck = ap->memaccess_tck;
+			break;
+		}
 		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], memaccess_tck);
 		ap->memaccess_tck = memaccess_tck;
+		ap->memaccess_tck_auto = false;
 		break;
 	default:
 		return ERROR_COMMAND_SYNTAX_ERROR;
 	}
 
+	bool automatic = ap->memaccess_tck_auto;
 	dap_put_ap(ap);
 
-	command_print(CMD, "memory bus access delay set to %" PRIu32 " tck",
-			memaccess_tck);
+	command_print(CMD, "memory bus access delay set to %" PRIu32 " tck%s",
+			memaccess_tck, automatic ? " (automatic)" : "");
 
 	return ERROR_OK;
 }
@@ -2962,8 +3045,8 @@ const struct command_registration dap_instance_commands[] = {
 		.handler = dap_memaccess_command,
 		.mode = COMMAND_EXEC,
 		.help = "set/get number of extra tck for MEM-AP memory "
-			"bus access [0-255]",
-		.usage = "[cycles]",
+			"bus access [0-255], or let it follow the WAIT responses",
+		.usage = "[cycles|'auto']",
 	},
 	{
 		.name = "ti_be_32_quirks",
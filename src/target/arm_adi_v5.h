@@ -305,6 +305,18 @@ struct adiv5_ap {
 	 */
 	uint32_t memaccess_tck;
 
+	/* true if memaccess_tck follows the WAIT responses, see mem_ap_tune() */
+	bool memaccess_tck_auto;
+	/* Transfers without WAIT since memaccess_tck was raised or lowered */
+	unsigned int memaccess_clean_transfers;
+	/* Transfers without WAIT required before lowering memaccess_tck */
+	unsigned int memaccess_clean_needed;
+
+	/* MEM-AP transfer counters, displayed by "dap info" */
+	uint64_t transfers;
+	uint64_t transfers_waited;
+	uint64_t transfers_failed;
+
 	/* Size of TAR autoincrement block, ARM ADI Specification requires at least 10 bits */
 	uint32_t tar_autoincr_block;
 
@@ -385,6 +397,9 @@ struct adiv5_dap {
 	/* information about current pending SWjDP-AHBAP transaction */
 	uint8_t  ack;
 
+	/** WAIT responses met by the transport on this DAP, see mem_ap_tune() */
+	unsigned int waits;
+
 	/**
 	 * Holds the pointer to the destination word for the last queued read,
 	 * for use with posted AP read sequence optimization.
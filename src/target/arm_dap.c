@@ -17,6 +17,7 @@
 #include "helper/command.h"
 #include "transport/transport.h"
 #include "jtag/interface.h"
+#include "jtag/swd_trace.h"
 
 static LIST_HEAD(all_dap);
 
@@ -108,7 +109,7 @@ static int dap_init_all(void)
 
 		if (transport_is_swd()) {
 			dap->ops = &swd_dap_ops;
-			obj->swd = adapter_driver->swd_ops;
+			obj->swd = swd_trace_wrap(adapter_driver->swd_ops);
 		} else if (transport_is_dapdirect_swd()) {
 			dap->ops = adapter_driver->dap_swd_ops;
 		} else if (transport_is_dapdirect_jtag()) {
@@ -175,6 +176,8 @@ int dap_cleanup_all(void)
 		free(obj);
 	}
 
+	swd_trace_record_stop();
+
 	return ERROR_OK;
 }
 
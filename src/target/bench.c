@@ -0,0 +1,441 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * Debug link benchmarks.
+ *
+ * Each benchmark repeats one operation, times every repetition and reports
+ * the latency distribution together with throughput and the number of JTAG
+ * queue flushes per operation, as text or as one JSON object per line so
+ * that results can be compared across adapters, firmware and OpenOCD
+ * versions.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/log.h>
+#include <helper/time_support.h>
+#include <jtag/jtag.h>
+#include <transport/transport.h>
+#include "bench.h"
+#include "target.h"
+#include "register.h"
+
+#define BENCH_DEFAULT_ITERATIONS	100
+
+struct bench_run {
+	struct command_invocation *cmd;
+	struct target *target;
+	unsigned int iterations;
+	bool json;
+	float *samples;
+	unsigned int count;
+	unsigned int flushes;
+	unsigned int flushes_start;
+	struct duration duration;
+};
+
+static int bench_float_cmp(const void *a, const void *b)
+{
+	float x = *(const float *)a;
+	float y = *(const float *)b;
+
+	return (x > y) - (x < y);
+}
+
+static float bench_percentile(const float *sorted, unsigned int count, unsigned int percent)
+{
+	return sorted[(count - 1) * percent / 100] * 1e6;
+}
+
+static void bench_begin(struct bench_run *run)
+{
+	run->count = 0;
+	run->flushes = 0;
+}
+
+static void bench_sample_start(struct bench_run *run)
+{
+	run->flushes_start = jtag_get_flush_queue_count();
+	duration_start(&run->duration);
+}
+
+static void bench_sample_end(struct bench_run *run)
+{
+	duration_measure(&run->duration);
+	run->samples[run->count++] = duration_elapsed(&run->duration);
+	run->flushes += jtag_get_flush_queue_count() - run->flushes_start;
+}
+
+/**
+ * Print the statistics of the repetitions collected since bench_begin().
+ *
+ * @param test Name of the benchmark.
+ * @param size Bytes transferred per repetition, 0 if not a transfer.
+ * @param width Access width in bytes, 0 if not applicable.
+ */
+static void bench_report(struct bench_run *run, const char *test,
+	uint32_t size, unsigned int width)
+{
+	if (!run->count)
+		return;
+
+	float total = 0;
+
+	for (unsigned int i = 0; i < run->count; i++)
+		total += run->samples[i];
+	qsort(run->samples, run->count, sizeof(*run->samples), bench_float_cmp);
+
+	float kibps = total > 0 ? (float)size * run->count / total / 1024 : 0;
+	float min = bench_percentile(run->samples, run->count, 0);
+	float p50 = bench_percentile(run->samples, run->count, 50);
+	float p90 = bench_percentile(run->samples, run->count, 90);
+	float p99 = bench_percentile(run->samples, run->count, 99);
+	float max = bench_percentile(run->samples, run->count, 100);
+	float flushes_per_op = (float)run->flushes / run->count;
+
+	if (run->json) {
+		command_print(run->cmd, "{\"test\": \"%s\", \"target\": \"%s\", "
+			"\"size\": %" PRIu32 ", \"width\": %u, \"iterations\": %u, "
+			"\"min_us\": %.3f, \"p50_us\": %.3f, \"p90_us\": %.3f, "
+			"\"p99_us\": %.3f, \"max_us\": %.3f, \"kib_per_s\": %.3f, "
+			"\"flushes_per_op\": %.3f}",
+			test, target_name(run->target), size, width, run->count,
+			min, p50, p90, p99, max, kibps, flushes_per_op);
+		return;
+	}
+
+	char what[32];
+	if (width)
+		snprintf(what, sizeof(what), "%" PRIu32 " B x%u", size, width);
+	else if (size)
+		snprintf(what, sizeof(what), "%" PRIu32 " B", size);
+	else
+		what[0] = '\0';
+
+	command_print(run->cmd, "%-12s %-12s min %.1f us, p50 %.1f us, p90 %.1f us, "
+		"p99 %.1f us, max %.1f us%s%.1f KiB/s, %.2f flushes/op",
+		test, what, min, p50, p90, p99, max,
+		size ? ", " : "", size ? kibps : 0, flushes_per_op);
+}
+
+/**
+ * Parse the trailing "[iterations] ['json']" arguments shared by all
+ * benchmarks and allocate the sample buffer.
+ */
+static int bench_setup(struct command_invocation *cmd, struct bench_run *run,
+	unsigned int first_optional)
+{
+	unsigned int argc = CMD_ARGC;
+
+	run->cmd = cmd;
+	run->target = get_current_target(CMD_CTX);
+	run->iterations = BENCH_DEFAULT_ITERATIONS;
+	run->json = false;
+	run->samples = NULL;
+
+	if (argc > first_optional && strcmp(CMD_ARGV[argc - 1], "json") == 0) {
+		run->json = true;
+		argc--;
+	}
+
+	if (argc < first_optional || argc > first_optional + 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (argc > first_optional) {
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[first_optional], run->iterations);
+		if (!run->iterations)
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	run->samples = malloc(run->iterations * sizeof(*run->samples));
+	if (!run->samples) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+static int bench_transfer(struct bench_run *run, target_addr_t address,
+	uint32_t size, unsigned int width, uint8_t *buffer)
+{
+	int retval;
+	const char *read_name = width ? "read_memory" : "read_buffer";
+	const char *write_name = width ? "write_memory" : "write_buffer";
+
+	bench_begin(run);
+	for (unsigned int i = 0; i < run->iterations; i++) {
+		bench_sample_start(run);
+		if (width)
+			retval = target_read_memory(run->target, address, width, size / width, buffer);
+		else
+			retval = target_read_buffer(run->target, address, size, buffer);
+		bench_sample_end(run);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	bench_report(run, read_name, size, width);
+
+	/* Write back what was just read, so the benchmark leaves memory intact */
+	bench_begin(run);
+	for (unsigned int i = 0; i < run->iterations; i++) {
+		bench_sample_start(run);
+		if (width)
+			retval = target_write_memory(run->target, address, width, size / width, buffer);
+		else
+			retval = target_write_buffer(run->target, address, size, buffer);
+		bench_sample_end(run);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	bench_report(run, write_name, size, width);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_bench_memory_command)
+{
+	if (CMD_ARGC < 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	target_addr_t address;
+	uint32_t size;
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[0], address);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], size);
+
+	if (size < 4 || address % 4) {
+		command_print(CMD, "size must be at least 4 and address word aligned");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	struct bench_run run;
+	int retval = CALL_COMMAND_HANDLER(bench_setup, &run, 2);
+	if (retval != ERROR_OK)
+		return retval;
+
+	uint8_t *buffer = malloc(size);
+	if (!buffer) {
+		LOG_ERROR("Out of memory");
+		free(run.samples);
+		return ERROR_FAIL;
+	}
+
+	/* Buffered transfers from one word up to the whole area */
+	uint32_t chunk = 4;
+	while (retval == ERROR_OK) {
+		retval = bench_transfer(&run, address, chunk, 0, buffer);
+		if (chunk == size)
+			break;
+		chunk = MIN((uint64_t)chunk * 4, size);
+	}
+
+	/* Fixed width accesses over the whole area */
+	for (unsigned int width = 1; retval == ERROR_OK && width <= 4; width *= 2)
+		retval = bench_transfer(&run, address, size & ~(width - 1), width, buffer);
+
+	free(buffer);
+	free(run.samples);
+	return retval;
+}
+
+COMMAND_HANDLER(handle_bench_latency_command)
+{
+	if (CMD_ARGC < 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	target_addr_t address;
+	uint32_t value;
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[0], address);
+
+	struct bench_run run;
+	int retval = CALL_COMMAND_HANDLER(bench_setup, &run, 1);
+	if (retval != ERROR_OK)
+		return retval;
+
+	bench_begin(&run);
+	for (unsigned int i = 0; i < run.iterations; i++) {
+		bench_sample_start(&run);
+		retval = target_read_u32(run.target, address, &value);
+		bench_sample_end(&run);
+		if (retval != ERROR_OK)
+			goto out;
+	}
+	bench_report(&run, "read_u32", 4, 4);
+
+	bench_begin(&run);
+	for (unsigned int i = 0; i < run.iterations; i++) {
+		bench_sample_start(&run);
+		retval = target_write_u32(run.target, address, value);
+		bench_sample_end(&run);
+		if (retval != ERROR_OK)
+			goto out;
+	}
+	bench_report(&run, "write_u32", 4, 4);
+
+	if (run.target->state != TARGET_HALTED) {
+		command_print(CMD, "target not halted, skipping register reads");
+		goto out;
+	}
+
+	struct reg **reg_list;
+	int reg_list_size;
+	retval = target_get_gdb_reg_list(run.target, &reg_list, &reg_list_size,
+			REG_CLASS_GENERAL);
+	if (retval != ERROR_OK)
+		goto out;
+
+	if (reg_list_size > 0 && reg_list[0]->dirty) {
+		/* invalidating it would discard the pending write */
+		command_print(CMD, "register %s modified, skipping register reads",
+				reg_list[0]->name);
+	} else if (reg_list_size > 0) {
+		struct reg *reg = reg_list[0];
+
+		bench_begin(&run);
+		for (unsigned int i = 0; i < run.iterations; i++) {
+			/* Force the register to be read from the target */
+			reg->valid = false;
+			bench_sample_start(&run);
+			retval = reg->type->get(reg);
+			bench_sample_end(&run);
+			if (retval != ERROR_OK)
+				break;
+		}
+		bench_report(&run, "read_reg", 0, 0);
+	}
+	free(reg_list);
+
+out:
+	free(run.samples);
+	return retval;
+}
+
+COMMAND_HANDLER(handle_bench_halt_command)
+{
+	struct bench_run run;
+	int retval = CALL_COMMAND_HANDLER(bench_setup, &run, 0);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (run.target->state != TARGET_HALTED) {
+		command_print(CMD, "target must be halted");
+		free(run.samples);
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	float *halt_samples = malloc(run.iterations * sizeof(*halt_samples));
+	if (!halt_samples) {
+		LOG_ERROR("Out of memory");
+		free(run.samples);
+		return ERROR_FAIL;
+	}
+
+	/* Resume and halt alternate, collect both series before reporting */
+	struct bench_run halt_run = run;
+	halt_run.samples = halt_samples;
+	bench_begin(&run);
+	bench_begin(&halt_run);
+
+	for (unsigned int i = 0; i < run.iterations; i++) {
+		bench_sample_start(&run);
+		retval = target_resume(run.target, 1, 0, 0, 0);
+		bench_sample_end(&run);
+		if (retval != ERROR_OK)
+			break;
+
+		bench_sample_start(&halt_run);
+		retval = target_halt(run.target);
+		if (retval == ERROR_OK)
+			retval = target_wait_state(run.target, TARGET_HALTED, 1000);
+		bench_sample_end(&halt_run);
+		if (retval != ERROR_OK)
+			break;
+	}
+
+	bench_report(&run, "resume", 0, 0);
+	bench_report(&halt_run, "halt", 0, 0);
+
+	free(halt_samples);
+	free(run.samples);
+	return retval;
+}
+
+COMMAND_HANDLER(handle_bench_flush_command)
+{
+	struct bench_run run;
+	int retval = CALL_COMMAND_HANDLER(bench_setup, &run, 0);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (!transport_is_jtag()) {
+		command_print(CMD, "queue flushes are only measured with the JTAG transport");
+		free(run.samples);
+		return ERROR_FAIL;
+	}
+
+	/* One idle clock per flush, to measure the adapter round trip */
+	bench_begin(&run);
+	for (unsigned int i = 0; i < run.iterations; i++) {
+		jtag_add_runtest(1, TAP_IDLE);
+		bench_sample_start(&run);
+		retval = jtag_execute_queue();
+		bench_sample_end(&run);
+		if (retval != ERROR_OK)
+			break;
+	}
+	bench_report(&run, "flush", 0, 0);
+
+	free(run.samples);
+	return retval;
+}
+
+static const struct command_registration bench_subcommand_handlers[] = {
+	{
+		.name = "memory",
+		.handler = handle_bench_memory_command,
+		.mode = COMMAND_EXEC,
+		.help = "measure buffered and fixed width memory transfers "
+			"of increasing size; the memory content is preserved",
+		.usage = "address size [iterations] ['json']",
+	},
+	{
+		.name = "latency",
+		.handler = handle_bench_latency_command,
+		.mode = COMMAND_EXEC,
+		.help = "measure single word read/write and register read latency",
+		.usage = "address [iterations] ['json']",
+	},
+	{
+		.name = "halt",
+		.handler = handle_bench_halt_command,
+		.mode = COMMAND_EXEC,
+		.help = "measure resume and halt latency; the target runs in between",
+		.usage = "[iterations] ['json']",
+	},
+	{
+		.name = "flush",
+		.handler = handle_bench_flush_command,
+		.mode = COMMAND_EXEC,
+		.help = "measure the JTAG queue flush round trip",
+		.usage = "[iterations] ['json']",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration bench_command_handlers[] = {
+	{
+		.name = "bench",
+		.mode = COMMAND_ANY,
+		.help = "debug link benchmarks",
+		.chain = bench_subcommand_handlers,
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int bench_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, bench_command_handlers);
+}
@@ -0,0 +1,10 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_TARGET_BENCH_H
+#define OPENOCD_TARGET_BENCH_H
+
+struct command_context;
+
+int bench_register_commands(struct command_context *cmd_ctx);
+
+#endif /* OPENOCD_TARGET_BENCH_H */
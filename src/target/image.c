@@ -23,6 +23,7 @@
 
 #include "image.h"
 #include "target.h"
+#include <helper/crc32.h>
 #include <helper/log.h>
 #include <server/server.h>
 
@@ -1171,6 +1172,18 @@ int image_read_section(struct image *image,
 	return ERROR_OK;
 }
 
+/* Sections of a builder image are allocated in powers of two, so that
+ * extending the last one piece by piece takes linear time */
+static size_t image_builder_capacity(uint32_t size)
+{
+	size_t capacity = 256;
+
+	while (capacity < size)
+		capacity *= 2;
+
+	return capacity;
+}
+
 int image_add_section(struct image *image, target_addr_t base, uint32_t size, uint64_t flags, uint8_t const *data)
 {
 	struct imagesection *section;
@@ -1187,7 +1200,14 @@ int image_add_section(struct image *image, target_addr_t base, uint32_t size, ui
 		 * adding data to previous sections or merging is not supported */
 		if (((section->base_address + section->size) == base) &&
 			(section->flags == flags)) {
-			section->private = realloc(section->private, section->size + size);
+			size_t capacity = image_builder_capacity(section->size);
+			if (section->size + size > capacity) {
+				void *private = realloc(section->private,
+					image_builder_capacity(section->size + size));
+				if (!private)
+					return ERROR_FAIL;
+				section->private = private;
+			}
 			memcpy((uint8_t *)section->private + section->size, data, size);
 			section->size += size;
 			return ERROR_OK;
@@ -1195,14 +1215,18 @@ int image_add_section(struct image *image, target_addr_t base, uint32_t size, ui
 	}
 
 	/* allocate new section */
+	section = realloc(image->sections, sizeof(struct imagesection) * (image->num_sections + 1));
+	if (!section)
+		return ERROR_FAIL;
+	image->sections = section;
+	section = &image->sections[image->num_sections];
+	section->private = malloc(image_builder_capacity(size));
+	if (!section->private)
+		return ERROR_FAIL;
 	image->num_sections++;
-	image->sections =
-		realloc(image->sections, sizeof(struct imagesection) * image->num_sections);
-	section = &image->sections[image->num_sections - 1];
 	section->base_address = base;
 	section->size = size;
 	section->flags = flags;
-	section->private = malloc(sizeof(uint8_t) * size);
 	memcpy((uint8_t *)section->private, data, size);
 
 	return ERROR_OK;
@@ -1270,31 +1294,12 @@ int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes, uint32_t *c
 	uint32_t crc = 0xffffffff;
 	LOG_DEBUG("Calculating checksum");
 
-	static uint32_t crc32_table[256];
-
-	static bool first_init;
-	if (!first_init) {
-		/* Initialize the CRC table and the decoding table.  */
-		unsigned int i, j, c;
-		for (i = 0; i < 256; i++) {
-			/* as per gdb */
-			for (c = i << 24, j = 8; j > 0; --j)
-				c = c & 0x80000000 ? (c << 1) ^ 0x04c11db7 : (c << 1);
-			crc32_table[i] = c;
-		}
-
-		first_init = true;
-	}
-
 	while (nbytes > 0) {
-		int run = nbytes;
-		if (run > 32768)
-			run = 32768;
+		uint32_t run = MIN(nbytes, 32768u);
+		/* as per gdb */
+		crc = crc32_be(CRC32_POLY_BE, crc, buffer, run);
+		buffer += run;
 		nbytes -= run;
-		while (run--) {
-			/* as per gdb */
-			crc = (crc << 8) ^ crc32_table[((crc >> 24) ^ *buffer++) & 255];
-		}
 		keep_alive();
 		if (openocd_is_shutdown_pending())
 			return ERROR_SERVER_INTERRUPTED;
@@ -1757,10 +1757,12 @@ static int examine(struct target *target)
 
 	target_set_examined(target);
 
+	target->smp_hw_halt_group = false;
 	if (target->smp) {
 		bool haltgroup_supported;
 		if (set_haltgroup(target, &haltgroup_supported) != ERROR_OK)
 			return ERROR_FAIL;
+		target->smp_hw_halt_group = haltgroup_supported;
 		if (haltgroup_supported)
 			LOG_INFO("Core %d made part of halt group %d.", target->coreid,
 					target->smp);
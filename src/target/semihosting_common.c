@@ -92,6 +92,17 @@ static int semihosting_common_fileio_info(struct target *target,
 	struct gdb_fileio_info *fileio_info);
 static int semihosting_common_fileio_end(struct target *target, int result,
 	int fileio_errno, bool ctrl_c);
+static void semihosting_flush_output(struct semihosting *semihosting);
+
+static int semihosting_flush_timer_callback(void *priv)
+{
+	struct target *target = priv;
+
+	if (target->semihosting)
+		semihosting_flush_output(target->semihosting);
+
+	return ERROR_OK;
+}
 
 /**
  * Initialize common semihosting support.
@@ -137,6 +148,9 @@ int semihosting_common_init(struct target *target, void *setup,
 	semihosting->sys_errno = -1;
 	semihosting->cmdline = NULL;
 	semihosting->basedir = NULL;
+	semihosting->out_len = 0;
+	semihosting->out_fd = -1;
+	semihosting->out_redirected = false;
 
 	/* If possible, update it in setup(). */
 	semihosting->setup_time = clock();
@@ -150,7 +164,27 @@ int semihosting_common_init(struct target *target, void *setup,
 	target->type->get_gdb_fileio_info = semihosting_common_fileio_info;
 	target->type->gdb_fileio_end = semihosting_common_fileio_end;
 
-	return ERROR_OK;
+	return target_register_timer_callback(semihosting_flush_timer_callback,
+			SEMIHOSTING_OUTPUT_FLUSH_MS, TARGET_TIMER_TYPE_PERIODIC, target);
+}
+
+/**
+ * Release common semihosting support, flushing any buffered output.
+ *
+ * @param target Pointer to the target being destroyed.
+ */
+void semihosting_common_deinit(struct target *target)
+{
+	struct semihosting *semihosting = target->semihosting;
+	if (!semihosting)
+		return;
+
+	semihosting_flush_output(semihosting);
+	target_unregister_timer_callback(semihosting_flush_timer_callback, target);
+
+	free(semihosting->basedir);
+	free(semihosting);
+	target->semihosting = NULL;
 }
 
 struct semihosting_tcp_service {
@@ -255,13 +289,123 @@ static ssize_t semihosting_redirect_read(struct semihosting *semihosting, void *
 	return retval;
 }
 
-static inline int semihosting_putchar(struct semihosting *semihosting, int fd, int c)
+/**
+ * Pass the buffered console output to its destination.
+ */
+static void semihosting_flush_output(struct semihosting *semihosting)
 {
-	if (semihosting_is_redirected(semihosting, fd))
-		return semihosting_redirect_write(semihosting, &c, 1);
+	if (!semihosting->out_len)
+		return;
+
+	/* Errors here belong to writes already reported as complete */
+	int sys_errno = semihosting->sys_errno;
+	ssize_t result;
+
+	if (semihosting->out_redirected) {
+		result = semihosting_redirect_write(semihosting, semihosting->out_buf,
+				semihosting->out_len);
+	} else if (semihosting->out_fd < 0) {
+		result = fwrite(semihosting->out_buf, 1, semihosting->out_len, stdout);
+		fflush(stdout);
+	} else {
+		result = write(semihosting->out_fd, semihosting->out_buf,
+				semihosting->out_len);
+	}
+
+	if (result != (ssize_t)semihosting->out_len)
+		LOG_ERROR("Failed to write %zu bytes of semihosting output",
+				semihosting->out_len);
+
+	semihosting->sys_errno = sys_errno;
+	semihosting->out_len = 0;
+}
+
+/**
+ * Queue console output in the host-side buffer.
+ *
+ * Output is written out when the buffer fills up, when its destination
+ * changes, before any other semihosting operation and periodically from
+ * a timer callback, so printing does not cost a host write per call.
+ *
+ * @param fd Target file descriptor, checked against the redirection.
+ * @param debug_channel True for SYS_WRITEC and SYS_WRITE0 output.
+ */
+static ssize_t semihosting_buffer_output(struct semihosting *semihosting, int fd,
+	bool debug_channel, const uint8_t *buf, size_t size)
+{
+	bool redirected = semihosting_is_redirected(semihosting, fd);
+
+	/* Without a client the error must reach the target */
+	if (redirected && !semihosting->tcp_connection)
+		return semihosting_redirect_write(semihosting, (void *)buf, size);
+
+	int out_fd = (redirected || debug_channel) ? -1 : fd;
+	if (semihosting->out_fd != out_fd || semihosting->out_redirected != redirected) {
+		semihosting_flush_output(semihosting);
+		semihosting->out_fd = out_fd;
+		semihosting->out_redirected = redirected;
+	}
+
+	for (size_t done = 0; done < size; ) {
+		size_t count = MIN(size - done,
+				SEMIHOSTING_OUTPUT_BUF_SIZE - semihosting->out_len);
+		memcpy(semihosting->out_buf + semihosting->out_len, buf + done, count);
+		semihosting->out_len += count;
+		done += count;
+
+		if (semihosting->out_len == SEMIHOSTING_OUTPUT_BUF_SIZE)
+			semihosting_flush_output(semihosting);
+	}
 
-	/* default putchar */
-	return putchar(c);
+	return size;
+}
+
+static bool semihosting_is_console(struct semihosting *semihosting, int fd)
+{
+	return fd >= 0 && (fd == semihosting->stdout_fd || fd == semihosting->stderr_fd);
+}
+
+/**
+ * Read a null-terminated string from the target.
+ *
+ * The string is fetched in aligned chunks instead of one byte at a time;
+ * reads never extend past the chunk holding the terminator.
+ *
+ * @param str Receives the string, to be released with free().
+ * @param len Receives the string length, without the terminator.
+ */
+static int semihosting_read_string(struct target *target, uint64_t addr,
+	char **str, size_t *len)
+{
+	char *buf = NULL;
+	size_t size = 0;
+
+	for (;;) {
+		uint32_t chunk = SEMIHOSTING_STRING_CHUNK - (addr % SEMIHOSTING_STRING_CHUNK);
+		char *new_buf = realloc(buf, size + chunk);
+		if (!new_buf) {
+			LOG_ERROR("out of memory");
+			free(buf);
+			return ERROR_FAIL;
+		}
+		buf = new_buf;
+
+		int retval = target_read_buffer(target, addr, chunk, (uint8_t *)buf + size);
+		if (retval != ERROR_OK) {
+			free(buf);
+			return retval;
+		}
+
+		char *end = memchr(buf + size, '\0', chunk);
+		if (end) {
+			*str = buf;
+			*len = end - buf;
+			return ERROR_OK;
+		}
+
+		size += chunk;
+		addr += chunk;
+	}
 }
 
 static inline ssize_t semihosting_read(struct semihosting *semihosting, int fd, void *buf, int size)
@@ -391,6 +535,19 @@ int semihosting_common(struct target *target)
 			  semihosting_opcode_to_str(semihosting->op),
 			  semihosting->param);
 
+	/* Keep buffered console output ordered with everything else */
+	switch (semihosting->op) {
+	case SEMIHOSTING_SYS_WRITE:
+	case SEMIHOSTING_SYS_WRITEC:
+	case SEMIHOSTING_SYS_WRITE0:
+		if (!semihosting->is_fileio)
+			break;
+		/* fall through */
+	default:
+		semihosting_flush_output(semihosting);
+		break;
+	}
+
 	switch (semihosting->op) {
 
 		case SEMIHOSTING_SYS_CLOCK:	/* 0x10 */
@@ -1388,7 +1545,11 @@ int semihosting_common(struct target *target)
 							free(buf);
 							return retval;
 						}
-						semihosting->result = semihosting_write(semihosting, fd, buf, len);
+						if (semihosting_is_console(semihosting, fd))
+							semihosting->result = semihosting_buffer_output(semihosting,
+									fd, false, buf, len);
+						else
+							semihosting->result = semihosting_write(semihosting, fd, buf, len);
 						LOG_DEBUG("write(%d, 0x%" PRIx64 ", %zu)=%" PRId64,
 							fd,
 							addr,
@@ -1432,7 +1593,8 @@ int semihosting_common(struct target *target)
 				retval = target_read_memory(target, addr, 1, 1, &c);
 				if (retval != ERROR_OK)
 					return retval;
-				semihosting_putchar(semihosting, semihosting->stdout_fd, c);
+				semihosting_buffer_output(semihosting, semihosting->stdout_fd,
+						true, &c, 1);
 				semihosting->result = 0;
 			}
 			break;
@@ -1451,33 +1613,28 @@ int semihosting_common(struct target *target)
 			 * None. The RETURN REGISTER is corrupted.
 			 */
 			if (semihosting->is_fileio) {
-				size_t count = 0;
-				uint64_t addr = semihosting->param;
-				for (;; addr++) {
-					unsigned char c;
-					retval = target_read_memory(target, addr, 1, 1, &c);
-					if (retval != ERROR_OK)
-						return retval;
-					if (c == '\0')
-						break;
-					count++;
-				}
+				char *str;
+				size_t count;
+				retval = semihosting_read_string(target, semihosting->param,
+						&str, &count);
+				if (retval != ERROR_OK)
+					return retval;
+				free(str);
 				semihosting->hit_fileio = true;
 				fileio_info->identifier = "write";
 				fileio_info->param_1 = 1;
 				fileio_info->param_2 = semihosting->param;
 				fileio_info->param_3 = count;
 			} else {
-				uint64_t addr = semihosting->param;
-				do {
-					unsigned char c;
-					retval = target_read_memory(target, addr++, 1, 1, &c);
-					if (retval != ERROR_OK)
-						return retval;
-					if (!c)
-						break;
-					semihosting_putchar(semihosting, semihosting->stdout_fd, c);
-				} while (1);
+				char *str;
+				size_t count;
+				retval = semihosting_read_string(target, semihosting->param,
+						&str, &count);
+				if (retval != ERROR_OK)
+					return retval;
+				semihosting_buffer_output(semihosting, semihosting->stdout_fd,
+						true, (uint8_t *)str, count);
+				free(str);
 				semihosting->result = 0;
 			}
 			break;
@@ -1921,6 +2078,7 @@ COMMAND_HANDLER(handle_common_semihosting_redirect_command)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 	}
 
+	semihosting_flush_output(semihosting);
 	semihosting_tcp_close_cnx(semihosting);
 	semihosting->redirect_cfg = SEMIHOSTING_REDIRECT_CFG_NONE;
 
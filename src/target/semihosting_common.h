@@ -75,6 +75,15 @@ enum semihosting_operation_numbers {
 /** Maximum allowed Tcl command segment length in bytes*/
 #define SEMIHOSTING_MAX_TCL_COMMAND_FIELD_LENGTH (1024 * 1024)
 
+/** Size of the host-side buffer collecting console output */
+#define SEMIHOSTING_OUTPUT_BUF_SIZE 1024
+
+/** Interval in ms at which buffered console output is flushed */
+#define SEMIHOSTING_OUTPUT_FLUSH_MS 100
+
+/** Alignment of the chunks in which strings are read from the target */
+#define SEMIHOSTING_STRING_CHUNK 64
+
 /*
  * Codes used by SEMIHOSTING_SYS_EXIT (formerly
  * SEMIHOSTING_REPORT_EXCEPTION).
@@ -177,6 +186,16 @@ struct semihosting {
 	/** Base directory for semihosting I/O operations. */
 	char *basedir;
 
+	/** Console output not yet passed to the host or the TCP redirect. */
+	uint8_t out_buf[SEMIHOSTING_OUTPUT_BUF_SIZE];
+	size_t out_len;
+
+	/** Host file descriptor of the buffered output, -1 for the debug channel. */
+	int out_fd;
+
+	/** A flag reporting whether the buffered output goes to the TCP redirect. */
+	bool out_redirected;
+
 	/**
 	 * Target's extension of semihosting user commands.
 	 * @returns ERROR_NOT_IMPLEMENTED when user command is not handled, otherwise
@@ -197,6 +216,7 @@ const char *semihosting_opcode_to_str(uint64_t opcode);
 
 int semihosting_common_init(struct target *target, void *setup,
 	void *post_result);
+void semihosting_common_deinit(struct target *target);
 int semihosting_common(struct target *target);
 
 /* utility functions which may also be used by semihosting extensions (custom vendor-defined syscalls) */
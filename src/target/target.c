@@ -32,6 +32,7 @@
 
 #include <helper/align.h>
 #include <helper/nvp.h>
+#include <helper/stats.h>
 #include <helper/time_support.h>
 #include <jtag/jtag.h>
 #include <flash/nor/core.h>
@@ -46,6 +47,7 @@
 #include "rtos/rtos.h"
 #include "transport/transport.h"
 #include "arm_cti.h"
+#include "bench.h"
 #include "smp.h"
 #include "semihosting_common.h"
 
@@ -565,6 +567,7 @@ int target_resume(struct target *target, int current, target_addr_t address,
 	}
 
 	target_call_event_callbacks(target, TARGET_EVENT_RESUME_START);
+	target->memory_generation++;
 
 	/* note that resume *must* be asynchronous. The CPU can halt before
 	 * we poll. The CPU can even halt at the current PC as a result of
@@ -602,8 +605,10 @@ static int target_process_reset(struct command_invocation *cmd, enum target_rese
 	}
 
 	struct target *target;
-	for (target = all_targets; target; target = target->next)
+	for (target = all_targets; target; target = target->next) {
+		target->memory_generation++;
 		target_call_reset_callbacks(target, reset_mode);
+	}
 
 	/* disable polling during reset to make reset event scripts
 	 * more predictable, i.e. dr/irscan & pathmove in events will
@@ -789,6 +794,7 @@ int target_run_algorithm(struct target *target,
 	}
 
 	target->running_alg = true;
+	target->memory_generation++;
 	retval = target->type->run_algorithm(target,
 			num_mem_params, mem_params,
 			num_reg_params, reg_param,
@@ -834,6 +840,7 @@ int target_start_algorithm(struct target *target,
 	}
 
 	target->running_alg = true;
+	target->memory_generation++;
 	retval = target->type->start_algorithm(target,
 			num_mem_params, mem_params,
 			num_reg_params, reg_params,
@@ -1245,7 +1252,12 @@ int target_read_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support read_memory", target_name(target));
 		return ERROR_FAIL;
 	}
-	return target->type->read_memory(target, address, size, count, buffer);
+	int retval = target->type->read_memory(target, address, size, count, buffer);
+	if (retval == ERROR_OK) {
+		target->stats_bytes_read += (uint64_t)size * count;
+		stats_add(STATS_TARGET_BYTES_READ, (uint64_t)size * count);
+	}
+	return retval;
 }
 
 int target_read_phys_memory(struct target *target,
@@ -1273,7 +1285,14 @@ int target_write_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_memory", target_name(target));
 		return ERROR_FAIL;
 	}
-	return target->type->write_memory(target, address, size, count, buffer);
+	target->memory_generation++;
+	target->memory_writes++;
+	int retval = target->type->write_memory(target, address, size, count, buffer);
+	if (retval == ERROR_OK) {
+		target->stats_bytes_written += (uint64_t)size * count;
+		stats_add(STATS_TARGET_BYTES_WRITTEN, (uint64_t)size * count);
+	}
+	return retval;
 }
 
 int target_write_phys_memory(struct target *target,
@@ -1287,6 +1306,8 @@ int target_write_phys_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_phys_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	target->memory_generation++;
+	target->memory_writes++;
 	return target->type->write_phys_memory(target, address, size, count, buffer);
 }
 
@@ -1413,6 +1434,7 @@ int target_step(struct target *target,
 	int retval;
 
 	target_call_event_callbacks(target, TARGET_EVENT_STEP_START);
+	target->memory_generation++;
 
 	retval = target->type->step(target, current, address, handle_breakpoints);
 	if (retval != ERROR_OK)
@@ -1450,6 +1472,26 @@ target_addr_t target_address_max(struct target *target)
 		return (((target_addr_t) 1) << bits) - 1;
 }
 
+unsigned int target_memory_generation(struct target *target)
+{
+	struct target_list *head;
+	unsigned int generation = 0;
+
+	if (!target) {
+		for (struct target *t = all_targets; t; t = t->next)
+			generation += t->memory_generation;
+		return generation;
+	}
+
+	if (list_empty(target->smp_targets))
+		return target->memory_generation;
+
+	foreach_smp_target(head, target->smp_targets)
+		generation += head->target->memory_generation;
+
+	return generation;
+}
+
 unsigned int target_address_bits(struct target *target)
 {
 	if (target->type->address_bits)
@@ -1819,7 +1861,13 @@ static int target_timer_callback_periodic_restart(
 static int target_call_timer_callback(struct target_timer_callback *cb,
 		int64_t *now)
 {
+	struct duration elapsed;
+
+	duration_start(&elapsed);
 	cb->callback(cb->priv);
+	if (duration_measure(&elapsed) == ERROR_OK)
+		stats_histogram_add(&stats_timer_callbacks,
+			(uint64_t)(duration_elapsed(&elapsed) * 1000000));
 
 	if (cb->type == TARGET_TIMER_TYPE_PERIODIC)
 		return target_timer_callback_periodic_restart(cb, now);
@@ -2187,9 +2235,7 @@ static void target_destroy(struct target *target)
 	if (target->type->deinit_target)
 		target->type->deinit_target(target);
 
-	if (target->semihosting)
-		free(target->semihosting->basedir);
-	free(target->semihosting);
+	semihosting_common_deinit(target);
 
 	jtag_unregister_event_callback(jtag_enable_callback, target);
 
@@ -2360,6 +2406,8 @@ int target_write_buffer(struct target *target, target_addr_t address, uint32_t s
 		return ERROR_FAIL;
 	}
 
+	target->memory_generation++;
+	target->memory_writes++;
 	return target->type->write_buffer(target, address, size, buffer);
 }
 
@@ -3608,6 +3656,198 @@ static COMMAND_HELPER(parse_load_image_command, struct image *image,
 	return ERROR_OK;
 }
 
+/* Find the part of a section of @a buf_cnt bytes at @a base_address to load */
+static bool load_image_clip(target_addr_t base_address, size_t buf_cnt,
+		target_addr_t min_address, target_addr_t max_address,
+		uint32_t *offset, uint32_t *length)
+{
+	*offset = 0;
+	*length = buf_cnt;
+
+	/* DANGER!!! beware of unsigned comparison here!!! */
+
+	if (base_address + buf_cnt < min_address || base_address >= max_address)
+		return false;
+
+	if (base_address < min_address) {
+		/* clip addresses below */
+		*offset += min_address - base_address;
+		*length -= *offset;
+	}
+
+	if (base_address + buf_cnt > max_address)
+		*length -= (base_address + buf_cnt) - max_address;
+
+	return true;
+}
+
+/* Blocks compared by load_image -diff with checksums, and the granules in
+ * which a differing block is then compared on the host */
+#define LOAD_IMAGE_DIFF_BLOCK		(64 * 1024)
+#define LOAD_IMAGE_DIFF_GRANULE		1024
+
+/* part of an image section that differs from target memory */
+struct load_image_diff {
+	unsigned int section;
+	uint32_t offset;
+	uint32_t size;
+};
+
+struct load_image_diffs {
+	struct load_image_diff *diffs;
+	unsigned int count;
+	unsigned int allocated;
+};
+
+static int load_image_diff_add(struct load_image_diffs *diffs, unsigned int section,
+		uint32_t offset, uint32_t size)
+{
+	struct load_image_diff *last = diffs->count ? &diffs->diffs[diffs->count - 1] : NULL;
+
+	if (last && last->section == section && last->offset + last->size == offset) {
+		last->size += size;
+		return ERROR_OK;
+	}
+
+	if (diffs->count == diffs->allocated) {
+		unsigned int allocated = diffs->allocated ? 2 * diffs->allocated : 16;
+		struct load_image_diff *new_diffs = realloc(diffs->diffs, allocated * sizeof(*new_diffs));
+		if (!new_diffs) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		diffs->diffs = new_diffs;
+		diffs->allocated = allocated;
+	}
+
+	diffs->diffs[diffs->count++] = (struct load_image_diff) {
+		.section = section,
+		.offset = offset,
+		.size = size,
+	};
+	return ERROR_OK;
+}
+
+/* Compare @a size bytes of section @a section with the target memory at
+ * @a address, and collect the granules which differ. Matching blocks are
+ * told by their checksum; a block that differs is read once and compared
+ * on the host, which costs less than checksumming ever smaller halves. */
+static int load_image_diff_block(struct target *target, struct load_image_diffs *diffs,
+		unsigned int section, uint32_t offset, target_addr_t address,
+		const uint8_t *buffer, uint32_t size)
+{
+	uint32_t checksum, mem_checksum;
+	int retval;
+
+	retval = image_calculate_checksum(buffer, size, &checksum);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = target_checksum_memory(target, address, size, &mem_checksum);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (checksum == mem_checksum)
+		return ERROR_OK;
+
+	uint8_t *mem = malloc(size);
+	if (!mem) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	retval = target_read_buffer(target, address, size, mem);
+	for (uint32_t pos = 0; pos < size && retval == ERROR_OK; pos += LOAD_IMAGE_DIFF_GRANULE) {
+		uint32_t granule = MIN(size - pos, LOAD_IMAGE_DIFF_GRANULE);
+		if (memcmp(buffer + pos, mem + pos, granule))
+			retval = load_image_diff_add(diffs, section, offset + pos, granule);
+	}
+
+	free(mem);
+	return retval;
+}
+
+/*
+ * Load only the parts of the image which differ from the target memory.
+ *
+ * All blocks are compared before the first one is written: the checksum
+ * algorithm may use a working area inside the loaded range, a block which
+ * then looks different is written afterwards.
+ */
+static COMMAND_HELPER(load_image_diff, struct target *target, struct image *image,
+		target_addr_t min_address, target_addr_t max_address, uint32_t *written)
+{
+	struct load_image_diffs diffs = { 0 };
+	uint8_t *buffer = NULL;
+	size_t buf_cnt;
+	uint32_t offset, length, total = 0;
+	int retval = ERROR_OK;
+
+	*written = 0;
+
+	for (unsigned int i = 0; i < image->num_sections && retval == ERROR_OK; i++) {
+		target_addr_t base_address = image->sections[i].base_address;
+
+		buffer = malloc(image->sections[i].size);
+		if (!buffer) {
+			command_print(CMD, "error allocating buffer for section (%" PRIu32 " bytes)",
+					image->sections[i].size);
+			retval = ERROR_FAIL;
+			break;
+		}
+
+		retval = image_read_section(image, i, 0x0, image->sections[i].size, buffer, &buf_cnt);
+		if (retval == ERROR_OK && load_image_clip(base_address, buf_cnt,
+				min_address, max_address, &offset, &length)) {
+			total += length;
+			while (length && retval == ERROR_OK) {
+				uint32_t size = MIN(length, LOAD_IMAGE_DIFF_BLOCK);
+				retval = load_image_diff_block(target, &diffs, i, offset,
+						base_address + offset, buffer + offset, size);
+				offset += size;
+				length -= size;
+			}
+		}
+
+		free(buffer);
+		buffer = NULL;
+	}
+
+	for (unsigned int d = 0; d < diffs.count && retval == ERROR_OK; d++) {
+		struct load_image_diff *diff = &diffs.diffs[d];
+
+		/* read each section once, its differences are next to each other */
+		if (d == 0 || diffs.diffs[d - 1].section != diff->section) {
+			free(buffer);
+			buffer = malloc(image->sections[diff->section].size);
+			if (!buffer) {
+				retval = ERROR_FAIL;
+				break;
+			}
+			retval = image_read_section(image, diff->section, 0x0,
+					image->sections[diff->section].size, buffer, &buf_cnt);
+			if (retval != ERROR_OK)
+				break;
+		}
+
+		target_addr_t address = image->sections[diff->section].base_address + diff->offset;
+		retval = target_write_buffer(target, address, diff->size, buffer + diff->offset);
+		if (retval != ERROR_OK)
+			break;
+		*written += diff->size;
+		command_print(CMD, "%" PRIu32 " bytes written at address " TARGET_ADDR_FMT,
+				diff->size, address);
+	}
+
+	free(buffer);
+	free(diffs.diffs);
+
+	if (retval == ERROR_OK)
+		command_print(CMD, "%" PRIu32 " bytes unchanged", total - *written);
+
+	return retval;
+}
+
 COMMAND_HANDLER(handle_load_image_command)
 {
 	uint8_t *buffer;
@@ -3616,6 +3856,13 @@ COMMAND_HANDLER(handle_load_image_command)
 	target_addr_t min_address = 0;
 	target_addr_t max_address = -1;
 	struct image image;
+	bool diff = false;
+
+	if (CMD_ARGC && strcmp(CMD_ARGV[0], "-diff") == 0) {
+		diff = true;
+		CMD_ARGV++;
+		CMD_ARGC--;
+	}
 
 	int retval = CALL_COMMAND_HANDLER(parse_load_image_command,
 			&image, &min_address, &max_address);
@@ -3624,6 +3871,12 @@ COMMAND_HANDLER(handle_load_image_command)
 
 	struct target *target = get_current_target(CMD_CTX);
 
+	if (diff && !target->type->checksum_memory) {
+		LOG_WARNING("Target %s doesn't support checksum_memory, loading the whole image",
+				target_name(target));
+		diff = false;
+	}
+
 	struct duration bench;
 	duration_start(&bench);
 
@@ -3632,6 +3885,12 @@ COMMAND_HANDLER(handle_load_image_command)
 
 	image_size = 0x0;
 	retval = ERROR_OK;
+	if (diff) {
+		retval = CALL_COMMAND_HANDLER(load_image_diff, target, &image,
+				min_address, max_address, &image_size);
+		goto done;
+	}
+
 	for (unsigned int i = 0; i < image.num_sections; i++) {
 		buffer = malloc(image.sections[i].size);
 		if (!buffer) {
@@ -3648,23 +3907,11 @@ COMMAND_HANDLER(handle_load_image_command)
 			break;
 		}
 
-		uint32_t offset = 0;
-		uint32_t length = buf_cnt;
-
-		/* DANGER!!! beware of unsigned comparison here!!! */
-
-		if ((image.sections[i].base_address + buf_cnt >= min_address) &&
-				(image.sections[i].base_address < max_address)) {
-
-			if (image.sections[i].base_address < min_address) {
-				/* clip addresses below */
-				offset += min_address-image.sections[i].base_address;
-				length -= offset;
-			}
-
-			if (image.sections[i].base_address + buf_cnt > max_address)
-				length -= (image.sections[i].base_address + buf_cnt)-max_address;
+		uint32_t offset;
+		uint32_t length;
 
+		if (load_image_clip(image.sections[i].base_address, buf_cnt,
+				min_address, max_address, &offset, &length)) {
 			retval = target_write_buffer(target,
 					image.sections[i].base_address + offset, length, buffer + offset);
 			if (retval != ERROR_OK) {
@@ -3680,6 +3927,7 @@ COMMAND_HANDLER(handle_load_image_command)
 		free(buffer);
 	}
 
+done:
 	if ((retval == ERROR_OK) && (duration_measure(&bench) == ERROR_OK)) {
 		command_print(CMD, "downloaded %" PRIu32 " bytes "
 				"in %fs (%0.3f KiB/s)", image_size,
@@ -3803,15 +4051,42 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 	image_size = 0x0;
 	int diffs = 0;
 	retval = ERROR_OK;
-	for (unsigned int i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
+	unsigned int next;
+	for (unsigned int i = 0; i < image.num_sections; i = next) {
+		target_addr_t base_address = image.sections[i].base_address;
+		uint32_t run_size = image.sections[i].size;
+
+		/* Sections following each other in memory are checked at once,
+		 * each target checksum has to load and run an algorithm */
+		next = i + 1;
+		while (verify >= IMAGE_VERIFY && next < image.num_sections
+				&& image.sections[next].base_address == base_address + run_size
+				&& run_size + image.sections[next].size > run_size) {
+			run_size += image.sections[next].size;
+			next++;
+		}
+
+		buffer = malloc(run_size);
 		if (!buffer) {
 			command_print(CMD,
 					"error allocating buffer for section (%" PRIu32 " bytes)",
-					image.sections[i].size);
+					run_size);
 			break;
 		}
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
+		buf_cnt = 0;
+		for (unsigned int j = i; j < next; j++) {
+			size_t size_read;
+			retval = image_read_section(&image, j, 0x0, image.sections[j].size,
+					buffer + buf_cnt, &size_read);
+			if (retval != ERROR_OK)
+				break;
+			buf_cnt += size_read;
+			if (size_read < image.sections[j].size) {
+				/* the rest of the run is no longer contiguous */
+				next = j + 1;
+				break;
+			}
+		}
 		if (retval != ERROR_OK) {
 			free(buffer);
 			break;
@@ -3825,7 +4100,9 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 				break;
 			}
 
-			retval = target_checksum_memory(target, image.sections[i].base_address, buf_cnt, &mem_checksum);
+			retval = flash_cache_checksum(target, base_address, buf_cnt, &mem_checksum);
+			if (retval != ERROR_OK)
+				retval = target_checksum_memory(target, base_address, buf_cnt, &mem_checksum);
 			if (retval != ERROR_OK) {
 				free(buffer);
 				break;
@@ -3845,7 +4122,7 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 
 				data = malloc(buf_cnt);
 
-				retval = target_read_buffer(target, image.sections[i].base_address, buf_cnt, data);
+				retval = target_read_buffer(target, base_address, buf_cnt, data);
 				if (retval == ERROR_OK) {
 					uint32_t t;
 					for (t = 0; t < buf_cnt; t++) {
@@ -3853,7 +4130,7 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 							command_print(CMD,
 								"diff %d address " TARGET_ADDR_FMT ". Was 0x%02" PRIx8 " instead of 0x%02" PRIx8,
 								diffs,
-								t + image.sections[i].base_address,
+								t + base_address,
 								data[t],
 								buffer[t]);
 							if (diffs++ >= 127) {
@@ -3876,7 +4153,7 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 			}
 		} else {
 			command_print(CMD, "address " TARGET_ADDR_FMT " length 0x%08zx",
-						  image.sections[i].base_address,
+						  base_address,
 						  buf_cnt);
 		}
 
@@ -6689,7 +6966,7 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.name = "load_image",
 		.handler = handle_load_image_command,
 		.mode = COMMAND_EXEC,
-		.usage = "filename [address ['bin'|'ihex'|'elf'|'s19' "
+		.usage = "['-diff'] filename [address ['bin'|'ihex'|'elf'|'s19' "
 			"[min_address [max_length]]]]",
 	},
 	{
@@ -6787,6 +7064,9 @@ static int target_register_user_commands(struct command_context *cmd_ctx)
 	if (retval != ERROR_OK)
 		return retval;
 
+	retval = bench_register_commands(cmd_ctx);
+	if (retval != ERROR_OK)
+		return retval;
 
 	return register_commands(cmd_ctx, NULL, target_exec_command_handlers);
 }
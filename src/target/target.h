@@ -191,6 +191,9 @@ struct target {
 	bool smp_halt_event_postponed;		/* Some SMP implementations (currently Cortex-M) stores
 										 * 'halted' events and emits them after all targets of
 										 * the SMP group has been polled */
+	bool smp_hw_halt_group;				/* The cores of the SMP group also halt together
+										 * in hardware (RISC-V halt groups), whatever
+										 * 'smp' says */
 
 	/* the gdb service is there in case of smp, we have only one gdb server
 	 * for all smp target
@@ -205,8 +208,17 @@ struct target {
 
 	int gdb_max_connections;			/* max number of simultaneous gdb connections */
 
+	/* incremented whenever target memory may have changed */
+	unsigned int memory_generation;
+	/* incremented by each memory write, a subset of memory_generation */
+	unsigned int memory_writes;
+
 	/* The semihosting information, extracted from the target. */
 	struct semihosting *semihosting;
+
+	/* Bytes moved by target_read_memory()/target_write_memory() */
+	uint64_t stats_bytes_read;
+	uint64_t stats_bytes_written;
 };
 
 struct target_list {
@@ -680,6 +692,13 @@ int target_gdb_fileio_end(struct target *target, int retcode, int fileio_errno,
  */
 target_addr_t target_address_max(struct target *target);
 
+/**
+ * Returns a value which changes whenever the memory seen by @a target may
+ * have changed: the sum of memory_generation over its SMP group, or over
+ * all targets if @a target is NULL.
+ */
+unsigned int target_memory_generation(struct target *target);
+
 /**
  * Return the number of address bits this target supports.
  *